@@ -0,0 +1,13 @@
+# A standalone timing program for the row kernels of the feature extraction; it does not
+# depend on Voreen. See tnm_stencilbenchmark.cpp
+TEMPLATE = app
+TARGET = stencilbenchmark
+CONFIG += console release
+CONFIG -= qt app_bundle
+
+# The sources include "modules/tnm093/...", so the Voreen root has to be on the include path
+INCLUDEPATH += ../../..
+
+SOURCES += \
+    tnm_stencilbenchmark.cpp \
+    ../src/tnm_stencil.cpp
@@ -0,0 +1,238 @@
+// Measures the row kernels of tnm_stencil against the loop that the extraction used before
+// them, and checks that both agree. That loop visits the voxels with x as the outermost and z
+// as the innermost index, so consecutive voxels are a whole plane apart in memory, reads every
+// voxel through VolumeAtomic::voxel() and writes the measures through Data::at(). It is copied
+// below with stand-ins for the two Voreen classes, so the program does not depend on Voreen.
+// Build it with benchmark/stencilbenchmark.pro or directly from the Voreen root, e.g.
+//   g++ -O2 -I. modules/tnm093/benchmark/tnm_stencilbenchmark.cpp modules/tnm093/src/tnm_stencil.cpp
+// Usage: stencilbenchmark [dimX dimY dimZ repetitions]
+
+#include "modules/tnm093/include/tnm_stencil.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#ifdef _MSC_VER
+// Only for the performance counter; without NOMINMAX, windows.h defines min and max as macros,
+// which break std::min and std::max
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+using namespace voreen;
+
+namespace {
+    double wallTime() {
+#ifdef _MSC_VER
+        LARGE_INTEGER counter, frequency;
+        QueryPerformanceCounter(&counter);
+        QueryPerformanceFrequency(&frequency);
+        return static_cast<double>(counter.QuadPart) / frequency.QuadPart;
+#else
+        timespec time;
+        clock_gettime(CLOCK_MONOTONIC, &time);
+        return time.tv_sec + time.tv_nsec * 1e-9;
+#endif
+    }
+
+    // The item of the measures before the columnar Data
+    const int NUM_DATA_VALUES = 4;
+    struct VoxelDataItem {
+        unsigned int voxelIndex;
+        float dataValues[NUM_DATA_VALUES];
+    };
+    typedef std::vector<VoxelDataItem> ItemData;
+
+    // Stands in for VolumeUInt16 with the same index computation
+    class Volume {
+    public:
+        Volume(int dimX, int dimY, int dimZ)
+            : _dimX(dimX), _dimY(dimY), _dimZ(dimZ)
+            , _voxels(static_cast<size_t>(dimX) * dimY * dimZ)
+        {}
+
+        size_t calcPos(int x, int y, int z) const {
+            return (static_cast<size_t>(z) * _dimY + y) * _dimX + x;
+        }
+        uint16_t voxel(size_t i) const { return _voxels[i]; }
+        uint16_t voxel(int x, int y, int z) const { return _voxels[calcPos(x, y, z)]; }
+
+        int _dimX;
+        int _dimY;
+        int _dimZ;
+        std::vector<uint16_t> _voxels;
+    };
+
+    // The extraction before the row kernels, unchanged except for the stand-ins. With
+    // 'gradientOnly', only the intensity and the gradient magnitude are computed, which is the
+    // part that gradientMagnitudeRow replaces
+    void originalLoop(const Volume* volume, ItemData* _data, bool gradientOnly) {
+        const int dim_x = volume->_dimX;
+        const int dim_y = volume->_dimY;
+        const int dim_z = volume->_dimZ;
+        for (int iX = 0; iX < dim_x; ++iX) {
+            for (int iY = 0; iY < dim_y; ++iY) {
+                for (int iZ = 0; iZ < dim_z; ++iZ) {
+                    const size_t i = volume->calcPos(iX, iY, iZ);
+                    _data->at(i).voxelIndex = static_cast<unsigned int>(i);
+                    float intensity = volume->voxel(_data->at(i).voxelIndex);
+                    _data->at(i).dataValues[0] = intensity;
+
+                    int topX = std::min(iX + 1, (dim_x-1));
+                    int topY = std::min(iY + 1, (dim_y-1));
+                    int topZ = std::min(iZ + 1, (dim_z-1));
+
+                    if (!gradientOnly) {
+                        float average = .0f;
+                        int count = 0;
+                        for (int jX = std::max(iX - 1, 0); jX < topX; jX++) {
+                            for (int jY = std::max(iY - 1, 0); jY < topY; jY++) {
+                                for (int jZ = std::max(iZ - 1, 0); jZ < topZ; jZ++) {
+                                    average += volume->voxel(jX, jY, jZ);
+                                    count++;
+                                }
+                            }
+                        }
+                        average /= count;
+                        _data->at(i).dataValues[1] = average;
+
+                        float stdDeviation = .0f;
+                        for (int jX = std::max(iX -1, 0); jX < topX; jX++) {
+                            for (int jY = std::max(iY -1, 0); jY < topY; jY++) {
+                                for (int jZ = std::max(iZ -1, 0); jZ < topZ; jZ++) {
+                                    stdDeviation += std::pow((volume->voxel(jX, jY, jZ) - average), 2);
+                                }
+                            }
+                        }
+                        stdDeviation /= count;
+                        stdDeviation = std::sqrt(stdDeviation);
+                        _data->at(i).dataValues[2] = stdDeviation;
+                    }
+
+                    int prevX = std::max(iX -1, 0);
+                    int prevY = std::max(iY -1, 0);
+                    int prevZ = std::max(iZ -1, 0);
+                    float gradientX = volume->voxel(topX, iY, iZ) - volume->voxel(prevX, iY, iZ);
+                    float gradientY = volume->voxel(iX, topY, iZ) - volume->voxel(iX, prevY, iZ);
+                    float gradientZ = volume->voxel(iX, iY, topZ) - volume->voxel(iX, iY, prevZ);
+                    gradientX /= 2;
+                    gradientY /= 2;
+                    gradientZ /= 2;
+                    _data->at(i).dataValues[3] = std::sqrt(gradientX * gradientX + gradientY * gradientY + gradientZ * gradientZ);
+                }
+            }
+        }
+    }
+
+    // A scalar Laplacian with clamped neighbors in x; the original loop did not compute one,
+    // so the row kernel is compared against this
+    void laplacianScalar(const float* row, const float* rowYMinus, const float* rowYPlus,
+                         const float* rowZMinus, const float* rowZPlus, int dimX, float* result)
+    {
+        for (int x = 0; x < dimX; ++x) {
+            const int xMinus = std::max(x - 1, 0);
+            const int xPlus = std::min(x + 1, dimX - 1);
+            const float neighbors = ((row[xMinus] + row[xPlus]) + (rowYMinus[x] + rowYPlus[x])) +
+                (rowZMinus[x] + rowZPlus[x]);
+            result[x] = neighbors - 6.f * row[x];
+        }
+    }
+
+    typedef void (*RowKernel)(const float*, const float*, const float*, const float*, const float*, int, float*);
+
+    // Applies the kernel to every row of the volume like the extraction does: the planes are
+    // converted to float as the z-window reaches them and kept in a ring of three. Returns the
+    // time per voxel in ns, including the conversion
+    double runRowKernel(RowKernel kernel, const Volume& volume, int repetitions, std::vector<float>& result) {
+        const int dimX = volume._dimX;
+        const int dimY = volume._dimY;
+        const int dimZ = volume._dimZ;
+        const size_t planeSize = static_cast<size_t>(dimX) * dimY;
+        std::vector<float> planes[3];
+        for (int k = 0; k < 3; ++k)
+            planes[k].resize(planeSize);
+
+        const double start = wallTime();
+        for (int repetition = 0; repetition < repetitions; ++repetition) {
+            convertToFloat(&volume._voxels[0], planeSize, &planes[0][0]);
+            for (int z = 0; z < dimZ; ++z) {
+                if (z + 1 < dimZ)
+                    convertToFloat(&volume._voxels[(z + 1) * planeSize], planeSize, &planes[(z + 1) % 3][0]);
+                const float* plane = &planes[z % 3][0];
+                const float* zMinus = &planes[std::max(z - 1, 0) % 3][0];
+                const float* zPlus = &planes[std::min(z + 1, dimZ - 1) % 3][0];
+                for (int y = 0; y < dimY; ++y) {
+                    const size_t row = static_cast<size_t>(y) * dimX;
+                    const size_t rowYMinus = static_cast<size_t>(std::max(y - 1, 0)) * dimX;
+                    const size_t rowYPlus = static_cast<size_t>(std::min(y + 1, dimY - 1)) * dimX;
+                    kernel(plane + row, plane + rowYMinus, plane + rowYPlus, zMinus + row, zPlus + row, dimX,
+                        &result[z * planeSize + row]);
+                }
+            }
+        }
+        return (wallTime() - start) * 1e9 / (static_cast<double>(planeSize) * dimZ * repetitions);
+    }
+
+    // Times the original loop; returns the time per voxel in ns
+    double runOriginalLoop(const Volume& volume, bool gradientOnly, int repetitions, ItemData& data) {
+        const double start = wallTime();
+        for (int repetition = 0; repetition < repetitions; ++repetition)
+            originalLoop(&volume, &data, gradientOnly);
+        return (wallTime() - start) * 1e9 / (static_cast<double>(data.size()) * repetitions);
+    }
+
+    // Returns the largest relative difference between the two results
+    float maxDifference(const std::vector<float>& a, const std::vector<float>& b) {
+        float difference = 0.f;
+        for (size_t i = 0; i < a.size(); ++i)
+            difference = std::max(difference, std::fabs(a[i] - b[i]) / std::max(1.f, std::fabs(a[i])));
+        return difference;
+    }
+}
+
+int main(int argc, char** argv) {
+    const int dimX = (argc > 4) ? std::atoi(argv[1]) : 256;
+    const int dimY = (argc > 4) ? std::atoi(argv[2]) : 256;
+    const int dimZ = (argc > 4) ? std::atoi(argv[3]) : 128;
+    const int repetitions = (argc > 4) ? std::atoi(argv[4]) : 3;
+    if (dimX <= 0 || dimY <= 0 || dimZ <= 0 || repetitions <= 0) {
+        std::printf("usage: %s [dimX dimY dimZ repetitions]\n", argv[0]);
+        return 1;
+    }
+
+    Volume volume(dimX, dimY, dimZ);
+    srand(1);
+    for (size_t i = 0; i < volume._voxels.size(); ++i)
+        volume._voxels[i] = static_cast<uint16_t>(rand() & 0xffff);
+    const size_t numVoxels = volume._voxels.size();
+    std::printf("%d x %d x %d voxels, %d repetitions\n", dimX, dimY, dimZ, repetitions);
+
+    ItemData data(numVoxels);
+    const double originalAll = runOriginalLoop(volume, false, repetitions, data);
+    const double originalGradient = runOriginalLoop(volume, true, repetitions, data);
+    std::vector<float> reference(numVoxels);
+    for (size_t i = 0; i < numVoxels; ++i)
+        reference[i] = data[i].dataValues[3];
+
+    std::vector<float> result(numVoxels);
+    const double gradientRow = runRowKernel(&gradientMagnitudeRow, volume, repetitions, result);
+    std::printf("original loop, all measures       %8.3f ns/voxel\n", originalAll);
+    std::printf("gradient magnitude                %8.3f ns/voxel original loop, %7.3f ns/voxel row kernel, %.1fx, max. difference %g\n",
+        originalGradient, gradientRow, originalGradient / gradientRow, maxDifference(reference, result));
+
+    const double laplacianScalarTime = runRowKernel(&laplacianScalar, volume, repetitions, reference);
+    const double laplacianRowTime = runRowKernel(&laplacianRow, volume, repetitions, result);
+    std::printf("Laplacian (not in original loop)  %8.3f ns/voxel scalar, %7.3f ns/voxel row kernel, %.1fx, max. difference %g\n",
+        laplacianScalarTime, laplacianRowTime, laplacianScalarTime / laplacianRowTime, maxDifference(reference, result));
+    return 0;
+}
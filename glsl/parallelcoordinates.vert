@@ -0,0 +1,46 @@
+#version 330
+// The values of the four axes as they are stored in the data. Every line is one instance, so
+// these are the same for all vertices of a line; see TNMParallelCoordinates::renderLines
+layout(location = 0) in float in_value0;
+layout(location = 1) in float in_value1;
+layout(location = 2) in float in_value2;
+layout(location = 3) in float in_value3;
+// Bit 1: the line is linked
+layout(location = 4) in uint in_flags;
+
+// Turns the values the shader receives into the decoded values in [-1,1]
+uniform float scale_;
+uniform float offset_;
+// The positions of the lower and upper handles of the four axes; a line that leaves any of
+// these ranges is brushed
+uniform vec4 lowerBound_;
+uniform vec4 upperBound_;
+// If set, only the linked lines are drawn in the highlight color, otherwise all lines are
+// drawn in the context color
+uniform bool linkedOnly_;
+
+out vec4 color;
+// The ids for the picking target: no handle, and the position of the line in the data plus 1.
+// Only used with picking.frag
+flat out uvec2 pickingId;
+
+void main() {
+    vec4 values = vec4(in_value0, in_value1, in_value2, in_value3) * scale_ + offset_;
+    bool isLinked = ((in_flags & 2u) != 0u);
+    if (any(lessThan(values, lowerBound_)) || any(greaterThan(values, upperBound_)) || (linkedOnly_ && !isLinked)) {
+        // All vertices of a brushed (or hidden) line are outside of the clip volume, so it is discarded
+        gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+        color = vec4(0.0);
+        pickingId = uvec2(0u);
+        return;
+    }
+
+    // Vertex i of the line strip is on axis i
+    int axis = gl_VertexID;
+    gl_Position = vec4(-1.0 + float(axis) * (2.0 / 3.0), values[axis], 0.0, 1.0);
+    pickingId = uvec2(0u, uint(gl_InstanceID + 1));
+    if (linkedOnly_)
+        color = vec4(1.0, 0.0, 0.0, 1.0);
+    else
+        color = vec4(0.4, 0.4, 0.4, 0.7);
+}
@@ -0,0 +1,36 @@
+#version 330
+// Draws the density of the lines between each pair of adjacent axes. Every instance is one bin
+// of the 2D histogram of a pair: the parallelogram between a bin on the left axis and a bin on
+// the right axis, drawn with the intensity of the bin; see TNMParallelCoordinates::renderDensity
+
+// The intensities of the bins; row (pair * numBins_ + left bin), column (right bin)
+uniform sampler2D density_;
+uniform int numBins_;
+uniform int numAxes_;
+
+out vec4 color;
+
+void main() {
+    int binsPerPair = numBins_ * numBins_;
+    int pair = gl_InstanceID / binsPerPair;
+    int leftBin = (gl_InstanceID / numBins_) % numBins_;
+    int rightBin = gl_InstanceID % numBins_;
+
+    float intensity = texelFetch(density_, ivec2(rightBin, pair * numBins_ + leftBin), 0).r;
+    if (intensity <= 0.0) {
+        // Empty bins are outside of the clip volume, so they are discarded
+        gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+        color = vec4(0.0);
+        return;
+    }
+
+    // Vertices 0 and 1 are the lower and upper end of the bin on the left axis, vertices 2 and 3
+    // the ones on the right axis
+    bool right = (gl_VertexID >= 2);
+    int bin = right ? rightBin : leftBin;
+    float binHeight = 2.0 / float(numBins_);
+    float x = -1.0 + float(right ? pair + 1 : pair) * (2.0 / float(numAxes_ - 1));
+    float y = -1.0 + (float(bin) + float(gl_VertexID % 2)) * binHeight;
+    gl_Position = vec4(x, y, 0.0, 1.0);
+    color = vec4(vec3(intensity), 1.0);
+}
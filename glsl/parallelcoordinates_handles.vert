@@ -0,0 +1,14 @@
+#version 330
+// Draws a handle of the parallel coordinates into the picking target; the vertices come from
+// TNMParallelCoordinates::AxisHandle::renderInternal
+layout(location = 0) in vec2 in_position;
+
+// The index of the handle plus 1
+uniform int handleId_;
+
+flat out uvec2 pickingId;
+
+void main() {
+    gl_Position = vec4(in_position, 0.0, 1.0);
+    pickingId = uvec2(uint(handleId_), 0u);
+}
@@ -0,0 +1,9 @@
+#version 330
+// The layer has the size of the viewport, so every fragment reads its own texel
+uniform sampler2D layer_;
+
+layout(location = 0) out vec4 fragColor;
+
+void main() {
+    fragColor = texelFetch(layer_, ivec2(gl_FragCoord.xy), 0);
+}
@@ -0,0 +1,7 @@
+#version 330
+// Covers the viewport with one triangle, so that a cached layer of the parallel coordinates
+// can be composited; see TNMParallelCoordinates::compositeLayer
+void main() {
+    vec2 position = vec2((gl_VertexID == 1) ? 3.0 : -1.0, (gl_VertexID == 2) ? 3.0 : -1.0);
+    gl_Position = vec4(position, 0.0, 1.0);
+}
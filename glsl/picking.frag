@@ -0,0 +1,9 @@
+#version 330
+// Writes the ids of the object into the integer picking target; 0 means no object
+flat in uvec2 pickingId;
+
+layout(location = 0) out uvec2 fragId;
+
+void main() {
+    fragId = pickingId;
+}
@@ -1,13 +1,28 @@
 #version 400
-layout(location = 0) in vec2 in_position;
-layout(location = 1) in uint in_selection;
+// The values of the two axes as they are stored in the data; see TNMScatterPlot::process
+layout(location = 0) in float in_firstValue;
+layout(location = 1) in float in_secondValue;
+// Bit 0: the point is brushed, bit 1: the point is selected
+layout(location = 2) in uint in_flags;
+
+// Maps the values of the axes to [-1,1]
+uniform vec2 scale_;
+uniform vec2 offset_;
 
 out float yPosition;
 
 void main() {
-    gl_Position = vec4(in_position, 0.0, 1.0);
-    yPosition = in_position.y;
-    bool isSelected = (in_selection == 1);
+    vec2 position = vec2(in_firstValue, in_secondValue) * scale_ + offset_;
+    yPosition = position.y;
+    bool isBrushed = ((in_flags & 1u) != 0u);
+    bool isSelected = ((in_flags & 2u) != 0u);
+    if (isBrushed) {
+        // Points outside of the clip volume are discarded
+        gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+        gl_PointSize = 1.f;
+        return;
+    }
+    gl_Position = vec4(position, 0.0, 1.0);
     if (isSelected)
     	gl_PointSize = 15.f; 
    	else
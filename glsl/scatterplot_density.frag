@@ -0,0 +1,25 @@
+#version 330
+// The intensities of the bins, one per pixel of the viewport; see TNMScatterPlot::computeDensity
+uniform sampler2D density_;
+
+layout(location = 0) out vec4 fragColor;
+
+// Maps the intensity to a color from dark blue over red to light yellow, so that the
+// brightness increases with the number of points
+vec3 colorMap(float intensity) {
+    const vec3 sparse = vec3(0.10, 0.05, 0.45);
+    const vec3 medium = vec3(0.85, 0.20, 0.30);
+    const vec3 dense = vec3(1.00, 0.95, 0.55);
+    if (intensity < 0.5)
+        return mix(sparse, medium, intensity * 2.0);
+    else
+        return mix(medium, dense, intensity * 2.0 - 1.0);
+}
+
+void main() {
+    float intensity = texelFetch(density_, ivec2(gl_FragCoord.xy), 0).r;
+    // Empty bins keep the cleared background
+    if (intensity <= 0.0)
+        discard;
+    fragColor = vec4(colorMap(intensity), 1.0);
+}
@@ -0,0 +1,8 @@
+// The version is defined in the header that TNMScatterPlotMatrix passes to the shader manager
+in vec4 color;
+
+layout(location = 0) out vec4 fragColor;
+
+void main() {
+    fragColor = color;
+}
@@ -0,0 +1,49 @@
+// The version and NUM_FEATURES, the number of features in the matrix, are defined in the
+// header that TNMScatterPlotMatrix passes to the shader manager
+
+// The values of the features as they are stored in the data; see TNMScatterPlotMatrix::process
+layout(location = 0) in float in_values[NUM_FEATURES];
+// Bit 0: the point is brushed, bit 1: the point is selected
+layout(location = NUM_FEATURES) in uint in_flags;
+
+// Maps the values of each feature to [-1,1]
+uniform float scale_[NUM_FEATURES];
+uniform float offset_[NUM_FEATURES];
+
+out vec4 color;
+
+void main() {
+    bool isBrushed = ((in_flags & 1u) != 0u);
+    bool isSelected = ((in_flags & 2u) != 0u);
+    if (isBrushed) {
+        // Points outside of the clip volume are discarded
+        gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+        gl_PointSize = 1.0;
+        color = vec4(0.0);
+        return;
+    }
+
+    // Every instance is one cell of the matrix; the diagonal is skipped. The row is the feature
+    // on the y axis, counted from the top, and the column the feature on the x axis
+    int row = gl_InstanceID / (NUM_FEATURES - 1);
+    int column = gl_InstanceID % (NUM_FEATURES - 1);
+    if (column >= row)
+        column += 1;
+
+    vec2 position = vec2(in_values[column] * scale_[column] + offset_[column],
+                         in_values[row] * scale_[row] + offset_[row]);
+
+    // The cell keeps a margin of 5% of its size on every side
+    float cellSize = 2.0 / float(NUM_FEATURES);
+    vec2 cellCenter = vec2(-1.0 + (float(column) + 0.5) * cellSize, 1.0 - (float(row) + 0.5) * cellSize);
+    gl_Position = vec4(cellCenter + position * (0.45 * cellSize), 0.0, 1.0);
+
+    if (isSelected) {
+        gl_PointSize = 5.0;
+        color = vec4(1.0, 0.0, 0.0, 1.0);
+    }
+    else {
+        gl_PointSize = 1.0;
+        color = vec4(0.3, 0.5, 0.8, 1.0);
+    }
+}
@@ -3,13 +3,14 @@
 
 #include "voreen/core/properties/condition.h"
 #include "voreen/core/properties/templateproperty.h"
+#include "modules/tnm093/include/tnm_common.h"
 
 namespace voreen {
 
 #ifdef DLL_TEMPLATE_INST
-template class VRN_CORE_API TemplateProperty<std::set<unsigned int> >;
+template class VRN_CORE_API TemplateProperty<IndexSet>;
 #endif
-class VRN_CORE_API IndexProperty : public TemplateProperty<std::set<unsigned int> > {
+class VRN_CORE_API IndexProperty : public TemplateProperty<IndexSet> {
 public:
     IndexProperty();
     IndexProperty(const std::string& id, const std::string& guiText);
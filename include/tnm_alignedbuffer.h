@@ -0,0 +1,47 @@
+#ifndef VRN_TNM_ALIGNEDBUFFER_H
+#define VRN_TNM_ALIGNEDBUFFER_H
+
+#include <cstddef>
+
+namespace voreen {
+
+// A resizable block of bytes whose beginning is aligned to ALIGNMENT bytes, so that the columns
+// of Data can be processed with aligned SIMD loads. The allocation is padded to a multiple of
+// ALIGNMENT, so vector loops may read (but not use) the bytes behind the last element.
+// New bytes are zero-initialized, like in a std::vector
+class AlignedBuffer {
+public:
+    // The alignment in bytes; large enough for AVX
+    static const size_t ALIGNMENT = 32;
+
+    AlignedBuffer();
+    AlignedBuffer(const AlignedBuffer& other);
+    ~AlignedBuffer();
+    AlignedBuffer& operator=(const AlignedBuffer& other);
+    void swap(AlignedBuffer& other);
+
+    unsigned char* data() { return _data; }
+    const unsigned char* data() const { return _data; }
+    size_t size() const { return _size; }
+    bool empty() const { return _size == 0; }
+    size_t capacity() const { return _capacity; }
+
+    // Changes the size to 'size' bytes, keeping the existing bytes; the capacity grows
+    // geometrically
+    void resize(size_t size);
+    // Makes sure that 'capacity' bytes fit without another allocation
+    void reserve(size_t capacity);
+    // Sets the size to zero but keeps the memory
+    void clear() { _size = 0; }
+    // Appends 'count' bytes at the end, growing the capacity geometrically
+    void append(const unsigned char* bytes, size_t count);
+
+private:
+    unsigned char* _data;
+    size_t _size;
+    size_t _capacity;
+};
+
+} // namespace voreen
+
+#endif // VRN_TNM_ALIGNEDBUFFER_H
@@ -0,0 +1,56 @@
+#ifndef VRN_TNM_BRUSHINGINDEX_H
+#define VRN_TNM_BRUSHINGINDEX_H
+
+#include "modules/tnm093/include/tnm_data.h"
+
+#include <stdint.h>
+#include <vector>
+
+namespace voreen {
+
+// Resolves the brushing of the parallel coordinates incrementally. An item is brushed if its
+// value on any axis is outside of the range [lower, upper] of that axis. For every axis, the
+// items are sorted by their value once per input, so changing the range of an axis only visits
+// the items whose value lies between the old and the new bounds, which are found by binary
+// search. For every item, the number of axes whose range it violates is kept, so the other
+// axes never have to be tested again. A value that is not a number never violates a range,
+// which matches the range test of the parallel coordinates shader
+class BrushingIndex {
+public:
+    BrushingIndex();
+
+    // Sorts the items of 'data' by the values of each of the 'numAxes' features and computes
+    // which items are brushed with the initial ranges [lower[k], upper[k]]
+    void build(const Data& data, const int* features, int numAxes, const float* lower, const float* upper);
+    // Releases the memory
+    void clear();
+
+    // Changes the range of 'axis'. The positions of the items that became brushed and of those
+    // that are not brushed anymore are appended to 'brushed' and 'unbrushed'
+    void setRange(int axis, float lower, float upper, std::vector<size_t>& brushed, std::vector<size_t>& unbrushed);
+
+    // The number of items
+    size_t size() const { return _violations.size(); }
+    // Returns true if item i is outside of the range of at least one axis
+    bool isBrushed(size_t i) const { return _violations[i] > 0; }
+
+private:
+    struct Axis {
+        std::vector<float> sortedValues; // The values of the axis in ascending order, without NaNs
+        std::vector<uint32_t> order; // The position of the item of each value in sortedValues
+        float lower; // The current range
+        float upper;
+    };
+
+    // Visits the items with values in [from, to] on 'axis' and updates their state for the
+    // change of the range from [oldLower, oldUpper] to the current one
+    void update(int axis, float from, float to, float oldLower, float oldUpper,
+        std::vector<size_t>& brushed, std::vector<size_t>& unbrushed);
+
+    std::vector<Axis> _axes;
+    std::vector<uint8_t> _violations; // The number of axes whose range each item violates
+};
+
+} // namespace voreen
+
+#endif // VRN_TNM_BRUSHINGINDEX_H
@@ -0,0 +1,116 @@
+#ifndef VRN_TNM_BRUSHINGWORKER_H
+#define VRN_TNM_BRUSHINGWORKER_H
+
+#include "modules/tnm093/include/tnm_brushingindex.h"
+#include "modules/tnm093/include/tnm_data.h"
+#include "modules/tnm093/include/tnm_indexset.h"
+
+#include <vector>
+
+namespace voreen {
+
+// Resolves the brushing of the parallel coordinates on a background thread, so dragging a
+// handle never waits for it. The GUI thread hands over the data and the ranges of the axes;
+// the worker keeps a BrushingIndex and the set of brushed voxels and updates both for the
+// latest ranges. Ranges that are requested while the worker is busy replace each other, so
+// the worker skips all but the newest one, and replacing the data cancels a rebuild of the
+// index for the old data. Every finished state is a consistent set for one request, which the
+// GUI thread takes with takeResult().
+// For the density mode, the worker also keeps a 2D histogram of the items that are not brushed
+// for every pair of adjacent axes. It is updated with the items whose state a request changes,
+// so dragging a handle only moves the lines between the old and the new bound from one bin to
+// another; the histograms of a request are taken with takeDensity()
+class BrushingWorker {
+public:
+    BrushingWorker();
+    ~BrushingWorker();
+
+    // Starts and stops the thread; stop() waits for the current computation
+    void start();
+    void stop();
+
+    // Replaces the data; the index is rebuilt for the next request. The data is shared, not copied
+    void setData(const Data& data, const int* features, int numAxes);
+    // Requests the brushed voxels for the ranges [lower[k], upper[k]] of the 'numAxes' axes. A
+    // request that has not been started yet is replaced
+    void request(const float* lower, const float* upper, int numAxes);
+    // Sets the number of bins per axis of the histograms over [-1,1]; 0 disables them. A change
+    // counts the items again with the latest ranges
+    void setDensityBins(int numBins);
+
+    // If a result has been finished since the last call, stores it in 'result' and returns true.
+    // The result shares its memory with the worker, so this is cheap
+    bool takeResult(IndexSet& result);
+    // If histograms have been finished since the last call, swaps them into 'counts' and returns
+    // true. 'numBins' is set to the bins per axis they were counted with; the count of the bin
+    // (left, right) between axis 'pair' and the next one is at
+    // (pair * numBins + left) * numBins + right
+    bool takeDensity(std::vector<uint32_t>& counts, int& numBins);
+    // Returns true if a request is pending or being computed
+    bool isBusy() const;
+    // Blocks until all requests are computed
+    void waitUntilIdle();
+
+private:
+    BrushingWorker(const BrushingWorker&);
+    BrushingWorker& operator=(const BrushingWorker&);
+
+    // The loop of the thread
+    void run();
+
+    // Brings _brushed and the histograms up to date with the ranges and the number of bins;
+    // returns false if it was canceled by new data
+    bool compute(const std::vector<float>& lower, const std::vector<float>& upper, int numBins);
+    // Adds the voxels of the items at 'positions' to _brushed or removes them
+    void setBrushed(const std::vector<size_t>& positions, bool brushed);
+    // Counts all items that are not brushed into _counts with 'numBins' bins per axis
+    void countDensity(int numBins);
+    // Adds the items at 'positions' to their bins in _counts (sign = 1) or removes them (sign = -1)
+    void updateDensity(const std::vector<size_t>& positions, int sign);
+    // Returns true if new data has been passed, which makes the current computation obsolete
+    bool isCanceled() const;
+
+    void lock() const;
+    void unlock() const;
+    // Waits for a notification; the mutex has to be locked
+    void wait() const;
+    // Wakes all waiting threads
+    void notify() const;
+
+    // The state that is shared between the threads; it is protected by the mutex
+    Data _pendingData; // The data that has been passed but not taken by the thread yet
+    std::vector<int> _pendingFeatures;
+    bool _hasPendingData;
+    std::vector<float> _requestLower; // The ranges of the latest request
+    std::vector<float> _requestUpper;
+    int _requestBins; // The number of bins per axis of the histograms, 0 if there are none
+    bool _hasRequest; // If a request has not been started yet
+    bool _computing; // If the thread computes a request
+    IndexSet _result; // The latest finished set of brushed voxels
+    bool _hasResult; // If _result has not been taken yet
+    std::vector<uint32_t> _densityResult; // The histograms that belong to _result
+    int _densityResultBins;
+    bool _hasDensityResult; // If _densityResult has not been taken yet
+    bool _stopping; // Makes the thread exit
+    bool _running; // If the thread has been started
+
+    // The state of the thread; only accessed by it
+    Data _data;
+    std::vector<int> _features;
+    BrushingIndex _index;
+    bool _indexValid; // If _index has been built for _data
+    std::vector<float> _lower; // The ranges that _index and _brushed are up to date with
+    std::vector<float> _upper;
+    IndexSet _brushed;
+    std::vector<uint32_t> _counts; // The histograms of the items that are not brushed
+    int _countBins; // The number of bins per axis of _counts, 0 if it is not up to date
+
+    // The thread, the mutex and the condition variable; they are defined in the source file,
+    // so that the platform headers are not included everywhere
+    struct Threading;
+    Threading* _threading;
+};
+
+} // namespace voreen
+
+#endif // VRN_TNM_BRUSHINGWORKER_H
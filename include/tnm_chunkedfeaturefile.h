@@ -0,0 +1,46 @@
+#ifndef VRN_TNM_CHUNKEDFEATUREFILE_H
+#define VRN_TNM_CHUNKEDFEATUREFILE_H
+
+#include "modules/tnm093/include/tnm_common.h"
+#include "tgt/vector.h"
+
+#include <fstream>
+#include <string>
+
+namespace voreen {
+
+// Writes the measures of a volume incrementally into a file that consists of independent
+// chunks, so that the results of the streaming extraction never have to be kept in memory.
+// The file starts with a header that contains the dimensions, the extracted features, the
+// number of chunks and the minimum and maximum of every measure. Each chunk consists of the index of its first voxel,
+// the number of items, and one float column per extracted feature. The values are stored
+// unnormalized; readers normalize them with the min/max values from the header the same way
+// TNMVolumeInformation does. Chunks may be written in any order
+class ChunkedFeatureWriter {
+public:
+    ChunkedFeatureWriter();
+    ~ChunkedFeatureWriter();
+
+    // Creates the file and writes a preliminary header. 'features' are the features that are
+    // written for every chunk. Returns false on failure
+    bool open(const std::string& fileName, const tgt::ivec3& dimensions, FeatureMask features);
+
+    // Appends a chunk of 'count' consecutive voxels starting at voxel 'firstIndex'. columns[k]
+    // contains the values of feature k; only the features passed to open() are used.
+    // Not thread-safe; concurrent writers have to be serialized by the caller
+    bool writeChunk(VoxelIndex firstIndex, const float* const* columns, size_t count);
+
+    // Writes the final header with the extrema of all measures and closes the file
+    bool close(const float* minValues, const float* maxValues);
+
+private:
+    std::ofstream _file;
+    tgt::ivec3 _dimensions;
+    FeatureMask _features;
+    uint64_t _numChunks;
+    uint64_t _numItems;
+};
+
+} // namespace voreen
+
+#endif // VRN_TNM_CHUNKEDFEATUREFILE_H
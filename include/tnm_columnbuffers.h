@@ -0,0 +1,53 @@
+#ifndef VRN_TNM_COLUMNBUFFERS_H
+#define VRN_TNM_COLUMNBUFFERS_H
+
+#include "modules/tnm093/include/tnm_data.h"
+#include "tgt/gl.h"
+
+#include <vector>
+
+namespace voreen {
+
+// Keeps the encoded values of some features of a Data object in vertex buffers, one buffer
+// per feature, so the renderers can use the columns as vertex attributes without converting
+// them. The buffers persist across frames and are only uploaded if the data or the features
+// change; if the new data extends the uploaded one (see Data::extends()), e.g. during a
+// progressive delivery, only the new items are appended
+class ColumnBuffers {
+public:
+    ColumnBuffers();
+
+    // Creates 'count' buffers; this needs an OpenGL context, e.g. in Processor::initialize()
+    void initialize(int count);
+    // Deletes the buffers and releases the uploaded data
+    void deinitialize();
+
+    // Brings buffer i up to date with the values of features[i] of 'data'. Returns the position
+    // of the first item that was uploaded: 0 if all items were uploaded, data.size() if the
+    // buffers were up to date already
+    size_t update(const Data& data, const int* features);
+
+    // The number of items in the buffers
+    size_t size() const { return _data.size(); }
+    // The encoding of the values in the buffers
+    Data::Encoding getEncoding() const { return _data.getEncoding(); }
+    GLuint getBuffer(int i) const { return _buffers[i]; }
+    // Enables the vertex attribute 'location' and lets it read buffer i with the format of the
+    // encoding. With a divisor of 1, there is one value per instance instead of one per vertex
+    void setAttribute(int i, GLuint location, GLuint divisor = 0) const;
+
+    // Describes how a column in 'encoding' is passed to the vertex shader: the type of the
+    // attribute, whether OpenGL maps it to [0,1], and the factor and offset that turn the value
+    // the shader receives into the decoded value
+    static void attributeFormat(Data::Encoding encoding, GLenum& type, GLboolean& normalized, float& scale, float& offset);
+
+private:
+    std::vector<GLuint> _buffers; // One vertex buffer per column
+    std::vector<int> _features; // The feature in each buffer; -1 if nothing is uploaded
+    size_t _capacity; // The number of values that fit into each buffer
+    Data _data; // The data whose values are in the buffers, to detect extensions of it
+};
+
+} // namespace voreen
+
+#endif // VRN_TNM_COLUMNBUFFERS_H
@@ -2,26 +2,21 @@
 #define VRN_TNM_COMMON_H
 
 #include "voreen/core/ports/genericport.h"
+#include "modules/tnm093/include/tnm_data.h"
+#include "modules/tnm093/include/tnm_featureregistry.h"
+#include "modules/tnm093/include/tnm_indexset.h"
 
+#include <stdint.h>
 #include <vector>
 
 namespace voreen {
 
-// The total number of data values that will be extracted
-// Intensity + Average + Standard Deviation + Gradient Magnitude
-const int NUM_DATA_VALUES = 4;
+// VoxelIndex, VoxelDataItem, and the Data container are defined in tnm_data.h, the IndexSet
+// of brushed or linked voxels in tnm_indexset.h
 
-
-struct VoxelDataItem { // There is one VoxelDataItem struct for each voxel in the dataset
-    unsigned int voxelIndex; // This is the index of the voxel from which the data was retrieved
-    float dataValues[NUM_DATA_VALUES]; // The list of data values for this specific voxel
-};
-
-// Just a typedef to make handling the data values easier
-typedef std::vector<VoxelDataItem> Data;
 // This port will be added to processors in order to exchange Data objects
 typedef GenericPort<Data> DataPort;
 
 } // namespace
 
-#endif // VRN_TNM_COMMON_H
\ No newline at end of file
+#endif // VRN_TNM_COMMON_H
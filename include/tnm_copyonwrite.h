@@ -0,0 +1,92 @@
+#ifndef VRN_TNM_COPYONWRITE_H
+#define VRN_TNM_COPYONWRITE_H
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace voreen {
+
+// A value of type T that is shared by all copies of the CopyOnWrite object until one of them
+// modifies it, which then receives its own copy first. This is used by Data so that views and
+// copies of the measures share the (large) arrays, and the arrays stay alive as long as any
+// processor still refers to them, independent of which port owns the Data object.
+// The reference count is updated atomically, so copies may be created and destroyed in
+// different threads; the value itself may only be modified by the thread that owns it
+template<typename T>
+class CopyOnWrite {
+public:
+    CopyOnWrite()
+        : _shared(new Shared)
+    {}
+
+    CopyOnWrite(const CopyOnWrite& other)
+        : _shared(other._shared)
+    {
+        retain(_shared);
+    }
+
+    ~CopyOnWrite() {
+        release(_shared);
+    }
+
+    CopyOnWrite& operator=(const CopyOnWrite& other) {
+        retain(other._shared);
+        release(_shared);
+        _shared = other._shared;
+        return *this;
+    }
+
+    const T& get() const { return _shared->value; }
+
+    // Returns the value for modification; if other objects share it, it is copied first
+    T& edit() {
+        if (isShared()) {
+            Shared* copy = new Shared(_shared->value);
+            release(_shared);
+            _shared = copy;
+        }
+        return _shared->value;
+    }
+
+    // Returns true if the value is shared with another CopyOnWrite object
+    bool isShared() const { return _shared->refCount != 1; }
+    // Returns true if this object and 'other' refer to the same value
+    bool sharesWith(const CopyOnWrite& other) const { return _shared == other._shared; }
+
+private:
+    struct Shared {
+        Shared() : value(), refCount(1) {}
+        explicit Shared(const T& value) : value(value), refCount(1) {}
+
+        T value;
+#ifdef _MSC_VER
+        volatile long refCount;
+#else
+        volatile int refCount;
+#endif
+    };
+
+    static void retain(Shared* shared) {
+#ifdef _MSC_VER
+        _InterlockedIncrement(&shared->refCount);
+#else
+        __sync_add_and_fetch(&shared->refCount, 1);
+#endif
+    }
+
+    static void release(Shared* shared) {
+#ifdef _MSC_VER
+        if (_InterlockedDecrement(&shared->refCount) == 0)
+#else
+        if (__sync_sub_and_fetch(&shared->refCount, 1) == 0)
+#endif
+            delete shared;
+    }
+
+    Shared* _shared;
+};
+
+} // namespace voreen
+
+#endif // VRN_TNM_COPYONWRITE_H
@@ -0,0 +1,246 @@
+#ifndef VRN_TNM_DATA_H
+#define VRN_TNM_DATA_H
+
+#include "modules/tnm093/include/tnm_alignedbuffer.h"
+#include "modules/tnm093/include/tnm_copyonwrite.h"
+#include "modules/tnm093/include/tnm_featureregistry.h"
+#include "modules/tnm093/include/tnm_quantization.h"
+#include "tgt/vector.h"
+
+#include <stdint.h>
+#include <vector>
+
+namespace voreen {
+
+// The total number of data values per voxel; there is one value for each registered feature
+// (see FeatureId). Values of features that were not requested by any consumer are not computed
+const int NUM_DATA_VALUES = NUM_FEATURES;
+
+// The index of a voxel in the volume; 64 bit wide so that volumes with more than 2^32 voxels
+// can be addressed
+typedef uint64_t VoxelIndex;
+
+struct VoxelDataItem { // There is one VoxelDataItem struct for each voxel in the dataset
+    VoxelIndex voxelIndex; // This is the index of the voxel from which the data was retrieved
+    float dataValues[NUM_DATA_VALUES]; // The list of data values for this specific voxel
+};
+
+// A read-only view of 'size' contiguous values of type T that are owned by another object, for
+// example one column of a Data object. The view stays valid until the owner is modified or destroyed
+template<typename T>
+class Span {
+public:
+    Span() : _data(0), _size(0) {}
+    Span(const T* data, size_t size) : _data(data), _size(size) {}
+
+    const T* data() const { return _data; }
+    size_t size() const { return _size; }
+    size_t sizeInBytes() const { return _size * sizeof(T); }
+    bool empty() const { return _size == 0; }
+
+    const T* begin() const { return _data; }
+    const T* end() const { return _data + _size; }
+    const T& operator[](size_t i) const { return _data[i]; }
+
+private:
+    const T* _data;
+    size_t _size;
+};
+
+// The measures of a set of voxels. The voxel indices and the values of every feature are stored
+// in separate arrays, and the values can be stored in a compact encoding to save memory and
+// bandwidth. Single values are decoded on access, ranges of values with getValues(), so
+// consumers never have to expand the whole data set to floats.
+// Only the columns of the features in getFeatures() are allocated; each of them is aligned for
+// SIMD access and can be handed to OpenGL as it is (see getColumn()). The voxel indices are
+// optional as well: if the items are every n-th voxel of the volume, as it is the case after
+// the extraction, the index of item i is implicitly i * n and no array is stored.
+// The arrays are shared between copies, so copying a Data object is cheap, and an object is
+// only copied when it is modified. A Data object can also be a view that contains a subset of
+// the items of another one (see slice() and select()) without copying any values; the arrays
+// stay alive as long as a copy or view refers to them.
+// For existing code, the items can still be accessed as VoxelDataItems, which decodes all
+// values of the item
+class Data {
+public:
+    // The ways a value can be stored
+    enum Encoding {
+        ENCODING_FLOAT32 = 0, // A 32-bit float; lossless
+        ENCODING_FLOAT16, // An IEEE half float; about three significant digits
+        ENCODING_FIXED16, // 16-bit fixed point that covers [-1,1]
+        ENCODING_FIXED8 // 8-bit fixed point that covers [-1,1]
+    };
+
+    // The encoded values of one feature. 'data' points to 'size' values of 'valueSize' bytes
+    // each, which are stored contiguously
+    struct Column {
+        Column() : data(0), size(0), encoding(ENCODING_FLOAT32), valueSize(sizeof(float)) {}
+
+        size_t sizeInBytes() const { return size * valueSize; }
+        // The values as an array of T; T has to match the encoding, i.e. float for
+        // ENCODING_FLOAT32, uint16_t for ENCODING_FLOAT16 and ENCODING_FIXED16 and uint8_t for
+        // ENCODING_FIXED8
+        template<typename T>
+        Span<T> values() const { return Span<T>(static_cast<const T*>(data), size); }
+
+        const void* data;
+        size_t size;
+        Encoding encoding;
+        size_t valueSize;
+    };
+
+    explicit Data(Encoding encoding = ENCODING_FLOAT32, FeatureMask features = FEATURES_ALL);
+
+    Encoding getEncoding() const { return _encoding; }
+    // Returns the number of bytes per stored value
+    size_t getValueSize() const;
+    // Returns the name of the encoding, e.g. for log messages and file names
+    static const char* encodingName(Encoding encoding);
+
+    // The features for which values are stored
+    FeatureMask getFeatures() const { return _features; }
+    bool hasFeature(int feature) const { return (_features & featureBit(feature)) != 0; }
+    // Allocates the columns for 'features' that are not stored yet; their values are zero
+    void addFeatures(FeatureMask features);
+
+    size_t size() const { return _size; }
+    bool empty() const { return _size == 0; }
+    void resize(size_t size);
+    void reserve(size_t size);
+    void clear();
+
+    // Returns a view of the items begin, begin + stride, ..., count items in total. This takes
+    // constant time, also for views
+    Data slice(size_t begin, size_t count, size_t stride = 1) const;
+    // Returns a view of the items at 'positions'. If the positions are ascending, the view is
+    // sorted the same way as this object
+    Data select(const std::vector<size_t>& positions) const;
+    // Returns true if this object is a view of a subset of the stored items
+    bool isView() const { return _hasRowList || _firstRow != 0 || _rowStride != 1; }
+    // Returns true if the items are stored contiguously, so getColumn() can be used
+    bool isContiguous() const { return !_hasRowList && _rowStride == 1; }
+    // Copies the items of a view into arrays of their own, so this is not a view anymore.
+    // All modifying functions do this implicitly
+    void materialize();
+    // Returns true if the first prefix.size() items of this object are the items of 'prefix'
+    // and both share their arrays, e.g. if both are prefixes of the same order and this one is
+    // longer. A consumer that has processed 'prefix' then only has to process the new items
+    bool extends(const Data& prefix) const;
+
+    inline VoxelIndex getVoxelIndex(size_t i) const;
+    // Sets the index of item i; if the indices are implicit and the index differs from the
+    // implicit one, the index array is created first
+    void setVoxelIndex(size_t i, VoxelIndex voxelIndex);
+    // Drops the index array; from now on, item i has the index i * stride
+    void setImplicitVoxelIndices(VoxelIndex stride = 1);
+    // Returns true if the indices are stored in an array, false if they are implicit
+    bool hasVoxelIndices() const { return _indexStride == 0; }
+    // The distance between the indices of consecutive items if they are implicit, 0 otherwise
+    VoxelIndex getVoxelIndexStride() const { return _indexStride; }
+    // Returns true if the voxel indices of the items are ascending
+    bool isSortedByVoxelIndex() const;
+
+    // The dimensions of the volume the items were extracted from, which relate the voxel
+    // indices to positions in the volume; (0,0,0) if they are unknown
+    const tgt::ivec3& getVolumeDimensions() const { return _volumeDimensions; }
+    void setVolumeDimensions(const tgt::ivec3& dimensions) { _volumeDimensions = dimensions; }
+    // The edge length of the blocks of voxels that the items stand for. An aggregated item (see
+    // TNMDataReduction) carries the index of one voxel of its block; 1 if every item is one voxel
+    int getBlockSize() const { return _blockSize; }
+    void setBlockSize(int blockSize) { _blockSize = blockSize; }
+    // Returns all voxels that the item with the passed voxel index stands for, so brushing and
+    // linking can be resolved to the voxels of the volume: the voxel itself, or all voxels of its block
+    void getMemberVoxels(VoxelIndex voxelIndex, std::vector<VoxelIndex>& members) const;
+    // The array of all voxel indices, e.g. to fill it in parallel. Returns 0 if the indices
+    // are implicit. The const version also returns 0 for views
+    VoxelIndex* getVoxelIndices();
+    const VoxelIndex* getVoxelIndices() const;
+
+    // Decodes the value of 'feature' for item i. The feature has to be stored
+    inline float getValue(size_t i, int feature) const;
+    // Encodes the value of 'feature' for item i
+    void setValue(size_t i, int feature, float value);
+    // Decodes the values of 'feature' for the items [begin, begin + count) into 'destination'
+    void getValues(int feature, size_t begin, size_t count, float* destination) const;
+    // Encodes the values of 'feature' for the items [begin, begin + count) from 'source'. As
+    // with all modifying functions, the arrays are copied first if they are shared; concurrent
+    // calls are only safe on an object whose arrays are not shared
+    void setValues(int feature, size_t begin, size_t count, const float* source);
+
+    // The encoded values of 'feature' for all items, getValueSize() bytes each. Returns 0 if
+    // the feature is not stored. The const version also returns 0 for views
+    unsigned char* getColumnData(int feature);
+    const unsigned char* getColumnData(int feature) const;
+    // A view of the encoded values of 'feature' that can be uploaded to a vertex buffer
+    // directly. The view is empty if the feature is not stored or the items are not
+    // contiguous; in that case, gatherColumn() has to be used
+    Column getColumn(int feature) const;
+    // Copies the encoded values of 'feature' of all items into 'buffer' and returns a view of it
+    Column gatherColumn(int feature, AlignedBuffer& buffer) const;
+
+    // Returns item i with all values decoded; the values of features that are not stored are 0
+    const VoxelDataItem operator[](size_t i) const;
+    // Same as operator[], but throws std::out_of_range for invalid indices
+    const VoxelDataItem at(size_t i) const;
+    // Encodes the stored values of the item and stores it at position i
+    void setItem(size_t i, const VoxelDataItem& item);
+    // Appends the item at the end
+    void push_back(const VoxelDataItem& item);
+    // Appends item i of 'other'. If both use the same encoding, the values are copied without
+    // decoding them; features that 'other' does not store are 0
+    void append(const Data& other, size_t i);
+
+private:
+    // The position of item i in the stored arrays
+    inline size_t row(size_t i) const;
+    // Creates the index array from the implicit indices
+    void materializeVoxelIndices();
+    // Copies the values of all items from 'column' (one of the stored arrays) to 'destination'
+    void gatherValues(const unsigned char* column, unsigned char* destination) const;
+
+    Encoding _encoding;
+    tgt::ivec3 _volumeDimensions;
+    int _blockSize;
+    FeatureMask _features; // The features whose columns are allocated
+    size_t _size; // The number of items
+    VoxelIndex _indexStride; // The stride of the implicit indices, or 0 if _voxelIndices is used
+    CopyOnWrite<std::vector<VoxelIndex> > _voxelIndices;
+    CopyOnWrite<AlignedBuffer> _columns[NUM_FEATURES]; // The encoded values, one array per feature
+
+    // The selection of a view: item i is stored in row _firstRow + i * _rowStride or, if the
+    // view has a row list, in the row that is stored at that position of the list. The row
+    // list is shared as well, so slicing a view does not copy it
+    size_t _firstRow;
+    size_t _rowStride;
+    bool _hasRowList;
+    CopyOnWrite<std::vector<size_t> > _rows;
+};
+
+size_t Data::row(size_t i) const {
+    const size_t position = _firstRow + i * _rowStride;
+    return _hasRowList ? _rows.get()[position] : position;
+}
+
+VoxelIndex Data::getVoxelIndex(size_t i) const {
+    const size_t r = row(i);
+    return _indexStride == 0 ? _voxelIndices.get()[r] : static_cast<VoxelIndex>(r) * _indexStride;
+}
+
+float Data::getValue(size_t i, int feature) const {
+    const size_t r = row(i);
+    const unsigned char* column = _columns[feature].get().data();
+    switch (_encoding) {
+        case ENCODING_FLOAT16:
+            return halfToFloat(reinterpret_cast<const uint16_t*>(column)[r]);
+        case ENCODING_FIXED16:
+            return decodeFixed(reinterpret_cast<const uint16_t*>(column)[r], 0xffff);
+        case ENCODING_FIXED8:
+            return decodeFixed(column[r], 0xff);
+        default:
+            return reinterpret_cast<const float*>(column)[r];
+    }
+}
+
+} // namespace voreen
+
+#endif // VRN_TNM_DATA_H
@@ -1,11 +1,18 @@
 #ifndef VRN_TNM_DATAREDUCTION_H
 #define VRN_TNM_DATAREDUCTION_H
 
+#include "voreen/core/properties/boolproperty.h"
+#include "voreen/core/properties/floatproperty.h"
+#include "voreen/core/properties/intproperty.h"
+#include "voreen/core/properties/optionproperty.h"
 #include "modules/tnm093/include/tnm_common.h"
+#include "modules/tnm093/include/tnm_refinementtimer.h"
+
+#include <vector>
 
 namespace voreen {
 
-class TNMDataReduction : public Processor {
+class TNMDataReduction : public Processor, public TNMFeatureConsumer {
 public:
     TNMDataReduction();
     Processor* create() const;
@@ -14,13 +21,71 @@ public:
     std::string getCategory() const     { return "tnm093"; }
     CodeState getCodeState() const      { return CODE_STATE_EXPERIMENTAL; }
 
+    // Passes on the features required by the processors connected to the outport, plus the
+    // importance feature if the reduction mode uses it
+    FeatureMask getRequiredFeatures() const;
+
+    // The ways in which the kept items are chosen
+    enum ReductionMode {
+        REDUCTION_UNIFORM = 0, // Every n-th item, regardless of its values
+        REDUCTION_STRATIFIED, // Every cell of a grid in feature space keeps items, so rare combinations of values survive
+        REDUCTION_IMPORTANCE, // The probability of keeping an item grows with the value of the importance feature
+        REDUCTION_RESERVOIR, // A fixed number of items, drawn at random and weighted like REDUCTION_IMPORTANCE
+        REDUCTION_SUPERVOXEL // One aggregated item for every block of k x k x k voxels
+    };
+
+    // How the items of a super-voxel are combined
+    enum Aggregation {
+        AGGREGATION_MEAN = 0, // The mean of every feature
+        AGGREGATION_MINIMUM, // The minimum of every feature
+        AGGREGATION_MAXIMUM, // The maximum of every feature
+        AGGREGATION_REPRESENTATIVE // The item that is closest to the mean in feature space
+    };
+
 protected:
     void process();
 
+private:
+    // Called when the mode or the importance feature changes, so that the source extracts the feature
+    void requestFeatures();
+    // Called when a parameter changes that the order of the level of detail depends on
+    void invalidateLevelOfDetail();
+
+    // Computes the order of the items for the level of detail, in which every prefix is a
+    // sample of the current mode
+    void buildLevelOfDetail(const Data& data);
+
+    // Assigns every item to a cell of the grid for the stratified mode and returns the number of cells
+    size_t stratificationCells(const Data& data, std::vector<uint32_t>& cells) const;
+    // Computes the probability with which each item is kept for the stratified mode
+    void stratifiedProbabilities(const Data& data, size_t targetCount, std::vector<float>& probabilities) const;
+    // Combines the items of every super-voxel into one item. The result is in the order of the
+    // blocks, so it is sorted by voxel index unless the representatives are used
+    Data* aggregateSuperVoxels(const Data& data) const;
+    // Computes the importance weight of each item from the importance feature
+    void importanceWeights(const Data& data, std::vector<float>& weights) const;
+
     DataPort _inport; // The incoming data
     DataPort _outport; // Outgoing, filtered data
 
     FloatProperty _percentage; // The percentage of how many values should be filtered away
+    IntOptionProperty _mode; // One of ReductionMode
+    IntOptionProperty _importanceFeature; // The feature whose values determine the importance of an item
+    FloatProperty _importanceExponent; // The importance is the normalized value to the power of this exponent
+    IntProperty _numBins; // The number of bins per feature for the stratified mode
+    IntProperty _sampleCount; // The number of items the reservoir mode keeps
+    IntProperty _superVoxelSize; // The edge length k of the super-voxels
+    IntOptionProperty _aggregation; // One of Aggregation
+    BoolProperty _levelOfDetail; // If the order of the items is precomputed, so a new percentage only takes a prefix
+    BoolProperty _progressive; // If the prefix of the level of detail is delivered in growing batches; needs _levelOfDetail
+    IntProperty _initialBatchSize; // The number of items in the first batch of the progressive delivery
+
+    Data _levelOfDetailOrder; // A view of the input in the order of the level of detail
+    bool _levelOfDetailValid; // If _levelOfDetailOrder matches the current parameters
+    size_t _deliveredCount; // The length of the prefix of _levelOfDetailOrder that was published last
+    RefinementTimer _refinementTimer; // Calls process() again for the next batch of the progressive delivery
+
+    static const std::string loggerCat_;
 };
 
 
@@ -0,0 +1,84 @@
+#ifndef VRN_TNM_FEATURECACHE_H
+#define VRN_TNM_FEATURECACHE_H
+
+#include "modules/tnm093/include/tnm_common.h"
+#include "tgt/vector.h"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace voreen {
+
+// A persistent cache for the measures computed by TNMVolumeInformation. Each cache entry is
+// a single binary file that consists of a fixed-size header followed by the voxel indices (if
+// they are not implicit) and the encoded values of every valid feature, so each array can be read in one go (or
+// memory-mapped) without any parsing.
+// Entries are identified by the volume dimensions and voxel type, the content hash of the
+// voxels, and the extraction parameters. The cache keeps an index file in the cache directory that stores the
+// size and the last use of each entry; if the total size exceeds the limit, the least
+// recently used entries are deleted
+class FeatureCache {
+public:
+    // Identifies a set of extracted measures
+    struct Key {
+        Key();
+        Key(const tgt::ivec3& dimensions, const std::string& voxelType, int radius,
+            Data::Encoding encoding, uint64_t contentHash);
+
+        // Returns the name of the file in which this entry is stored
+        std::string fileName() const;
+
+        tgt::ivec3 dimensions; // The dimensions of the volume
+        std::string voxelType; // The name of the voxel type, e.g. "uint16"
+        int radius; // The neighborhood radius used for the extraction
+        Data::Encoding encoding; // The encoding in which the values are stored
+        uint64_t contentHash; // The hash of the voxel values, see FeatureCache::hashContent
+    };
+
+    FeatureCache();
+
+    // Sets the directory in which the cache files and the index are stored
+    void setDirectory(const std::string& directory);
+    // Sets the maximum number of bytes all cache entries together may use
+    void setSizeLimit(uint64_t sizeLimit);
+
+    // Loads the measures for 'key' into 'data', which receives the encoding of the key, and
+    // returns the features that are valid in 'features'. Returns false if there is no (valid) entry
+    bool load(const Key& key, Data& data, FeatureMask& features);
+    // Stores the measures for 'key', of which 'features' are valid, and evicts the oldest
+    // entries if the size limit is exceeded. Returns false if the entry could not be written
+    bool store(const Key& key, const Data& data, FeatureMask features);
+
+    // Computes a 64-bit hash (FNV-1a) of the passed memory. The memory is hashed in fixed
+    // chunks in parallel, so the result does not depend on the number of threads
+    static uint64_t hashContent(const void* data, size_t numBytes);
+
+private:
+    // One line in the index file
+    struct Entry {
+        std::string fileName; // The file name relative to the cache directory
+        uint64_t size; // The size of the file in bytes
+        uint64_t lastUse; // A counter that is increased whenever an entry is used
+    };
+
+    // Returns the size of the cache file that stores 'features' of 'data'
+    static uint64_t fileSize(const Data& data, FeatureMask features);
+
+    // Returns the absolute path of a file in the cache directory
+    std::string path(const std::string& fileName) const;
+
+    std::vector<Entry> readIndex() const;
+    void writeIndex(const std::vector<Entry>& entries) const;
+    // Marks the entry as most recently used, adding it to the index if necessary
+    void touch(std::vector<Entry>& entries, const std::string& fileName, uint64_t size) const;
+
+    std::string _directory;
+    uint64_t _sizeLimit;
+
+    static const std::string loggerCat_;
+};
+
+} // namespace voreen
+
+#endif // VRN_TNM_FEATURECACHE_H
@@ -0,0 +1,84 @@
+#ifndef VRN_TNM_FEATUREREGISTRY_H
+#define VRN_TNM_FEATUREREGISTRY_H
+
+#include <stdint.h>
+#include <string>
+
+namespace voreen {
+
+class Port;
+
+// The measures (features) that TNMVolumeInformation can extract for each voxel. The value of
+// each entry is the index of the feature in VoxelDataItem::dataValues. A new measure is added
+// by appending it here, describing it in tnm_featureregistry.cpp and computing it in the
+// extraction; processors that do not request it never pay for it
+enum FeatureId {
+    FEATURE_INTENSITY = 0,
+    FEATURE_AVERAGE,
+    FEATURE_STD_DEVIATION,
+    FEATURE_GRADIENT_MAGNITUDE,
+    FEATURE_LAPLACIAN,
+    NUM_FEATURES
+};
+
+// A set of features; bit i is set if the feature with the FeatureId i is contained
+typedef uint32_t FeatureMask;
+
+// Returns the mask that only contains the passed feature
+inline FeatureMask featureBit(int feature) {
+    return static_cast<FeatureMask>(1) << feature;
+}
+
+// Returns the number of features in the mask
+inline int featureCount(FeatureMask features) {
+    int count = 0;
+    for (; features != 0; features &= features - 1)
+        ++count;
+    return count;
+}
+
+// The features that were always computed before the registry existed. They are used for
+// consumers that do not declare what they need
+const FeatureMask FEATURES_DEFAULT = (1 << FEATURE_INTENSITY) | (1 << FEATURE_AVERAGE) |
+    (1 << FEATURE_STD_DEVIATION) | (1 << FEATURE_GRADIENT_MAGNITUDE);
+// The features that depend on the neighborhood radius and have to be recomputed if it changes
+const FeatureMask FEATURES_RADIUS_DEPENDENT = (1 << FEATURE_AVERAGE) | (1 << FEATURE_STD_DEVIATION);
+// All registered features
+const FeatureMask FEATURES_ALL = (1 << NUM_FEATURES) - 1;
+
+// Describes a feature for the user interface and the serialization
+struct FeatureDescriptor {
+    const char* identifier; // A unique, stable identifier, e.g. used for option properties
+    const char* name; // The name that is shown to the user
+};
+
+// Returns the description of the feature
+const FeatureDescriptor& featureDescriptor(int feature);
+
+// Returns the comma-separated names of the features in the mask, e.g. for log messages
+std::string featureNames(FeatureMask features);
+
+// Processors that read Data from an inport implement this interface to declare which features
+// they read. TNMVolumeInformation only extracts the features that are requested by the
+// processors connected to its outport
+class TNMFeatureConsumer {
+public:
+    virtual ~TNMFeatureConsumer() {}
+
+    // Returns the features that this processor reads from its data inport
+    virtual FeatureMask getRequiredFeatures() const = 0;
+};
+
+// Returns the union of the features that are required by the processors connected to the
+// outport. Processors that are not TNMFeatureConsumers are assumed to need FEATURES_DEFAULT,
+// which is also returned if nothing is connected
+FeatureMask collectRequiredFeatures(const Port* outport);
+
+// Invalidates the processors that provide the data for the inport, so that they re-evaluate
+// the required features. The invalidation is passed through processors that are
+// TNMFeatureConsumers themselves (e.g. TNMDataReduction) up to the extracting processor
+void invalidateFeatureSources(const Port* inport);
+
+} // namespace voreen
+
+#endif // VRN_TNM_FEATUREREGISTRY_H
@@ -0,0 +1,139 @@
+#ifndef VRN_TNM_INDEXSET_H
+#define VRN_TNM_INDEXSET_H
+
+#include "modules/tnm093/include/tnm_copyonwrite.h"
+#include "modules/tnm093/include/tnm_data.h"
+
+#include <cstddef>
+#include <iterator>
+#include <stdint.h>
+#include <vector>
+
+namespace voreen {
+
+// A set of voxel indices, for example the brushed or linked voxels, stored as a compressed
+// bitmap. The indices are split into chunks of 2^16 by their upper bits, and each chunk stores
+// the lower 16 bits of its indices in the smallest of three containers: a sorted array if the
+// chunk has few indices, a bitmap of 2^16 bits if it has many, or a list of runs of consecutive
+// indices, which is what the blocks of a brushed volume mostly consist of (see optimize()).
+// A selected voxel costs at most two bytes instead of the node of a std::set, membership is
+// a binary search over the chunks followed by a lookup in one container, and union and
+// intersection combine the containers chunk by chunk.
+// The containers are shared between copies, so that copying a set, e.g. into an IndexProperty,
+// does not copy the indices; a modification only copies the containers it touches
+class IndexSet {
+public:
+    // The number of indices that a chunk covers is 2^CHUNK_BITS
+    static const int CHUNK_BITS = 16;
+
+    class const_iterator;
+
+    IndexSet();
+
+    // The number of indices in the set
+    size_t size() const;
+    bool empty() const { return _keys.empty(); }
+    void clear();
+
+    bool contains(VoxelIndex index) const;
+    // The same as contains(); for code that uses the interface of std::set
+    size_t count(VoxelIndex index) const { return contains(index) ? 1 : 0; }
+
+    // Adds the index and returns true if it was not in the set
+    bool insert(VoxelIndex index);
+    template<typename InputIterator>
+    void insert(InputIterator first, InputIterator last) {
+        for (; first != last; ++first)
+            insert(*first);
+    }
+    // Removes the index and returns true if it was in the set
+    bool erase(VoxelIndex index);
+
+    // Adds all indices of 'other' to this set
+    void unite(const IndexSet& other);
+    // Removes all indices that are not in 'other'
+    void intersect(const IndexSet& other);
+    // Removes all indices that are in 'other'
+    void subtract(const IndexSet& other);
+
+    // Converts every container to the smallest representation of its indices, in particular
+    // consecutive indices to runs. Inserting indices one by one only creates arrays and
+    // bitmaps, so this should be called before a large set is published
+    void optimize();
+    // The memory that the containers use
+    size_t sizeInBytes() const;
+
+    bool operator==(const IndexSet& other) const;
+    bool operator!=(const IndexSet& other) const { return !(*this == other); }
+
+    // Iterates over the indices in ascending order
+    const_iterator begin() const;
+    const_iterator end() const;
+
+    // A run of the consecutive indices [start, last] in a chunk
+    struct Run {
+        uint16_t start;
+        uint16_t last;
+    };
+
+    // The indices of one chunk; only the member of the current type is used
+    struct Container {
+        enum Type {
+            TYPE_ARRAY = 0, // The sorted indices in 'values'
+            TYPE_BITMAP, // One bit per index in 'words'
+            TYPE_RUNS // The sorted, disjoint runs in 'runs'
+        };
+
+        Container() : type(TYPE_ARRAY), cardinality(0) {}
+
+        Type type;
+        uint32_t cardinality; // The number of indices
+        std::vector<uint16_t> values;
+        std::vector<uint64_t> words;
+        std::vector<Run> runs;
+    };
+
+    class const_iterator {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef VoxelIndex value_type;
+        typedef ptrdiff_t difference_type;
+        typedef const VoxelIndex* pointer;
+        typedef VoxelIndex reference;
+
+        const_iterator() : _set(0), _chunk(0), _position(0), _low(0) {}
+
+        VoxelIndex operator*() const;
+        const_iterator& operator++();
+        const_iterator operator++(int) { const_iterator result = *this; ++*this; return result; }
+
+        bool operator==(const const_iterator& other) const {
+            return (_set == other._set) && (_chunk == other._chunk) && (_low == other._low);
+        }
+        bool operator!=(const const_iterator& other) const { return !(*this == other); }
+
+    private:
+        friend class IndexSet;
+        const_iterator(const IndexSet* set, size_t chunk);
+        // Moves to the first index of the current chunk, or to the end if there are no more chunks
+        void enterChunk();
+
+        const IndexSet* _set;
+        size_t _chunk; // The position of the current chunk in _keys
+        size_t _position; // The position of the current value or run in the container
+        uint32_t _low; // The lower bits of the current index
+    };
+
+private:
+    // The position of the chunk of 'key' in _keys, or _keys.size() if there is none
+    size_t findChunk(uint64_t key) const;
+    // Removes the chunk at 'position' if its container became empty
+    void removeIfEmpty(size_t position);
+
+    std::vector<uint64_t> _keys; // The upper bits of the indices of each chunk, ascending
+    std::vector<CopyOnWrite<Container> > _containers; // The container of each chunk; none is empty
+};
+
+} // namespace voreen
+
+#endif // VRN_TNM_INDEXSET_H
@@ -0,0 +1,78 @@
+#ifndef VRN_TNM_INTEGRALVOLUME_H
+#define VRN_TNM_INTEGRALVOLUME_H
+
+#include "tgt/vector.h"
+
+#include <stdint.h>
+#include <vector>
+
+namespace voreen {
+
+// Selects the accumulator for the sums of a voxel type. The integer accumulators are large
+// enough for the squared sums of neighborhoods with a radius of up to 16 voxels. 'exact' is
+// true if adding and subtracting values in the accumulator is exact, so the z-window may slide
+template<typename T> struct IntegralVolumeTraits;
+template<> struct IntegralVolumeTraits<uint8_t> { typedef uint64_t Accumulator; static const bool exact = true; };
+template<> struct IntegralVolumeTraits<uint16_t> { typedef uint64_t Accumulator; static const bool exact = true; };
+template<> struct IntegralVolumeTraits<int16_t> { typedef int64_t Accumulator; static const bool exact = true; };
+template<> struct IntegralVolumeTraits<float> { typedef double Accumulator; static const bool exact = false; };
+
+// A summed-volume table of the voxel values and the squared voxel values that allows the
+// computation of the average and standard deviation of a box-shaped neighborhood in O(1),
+// independent of the neighborhood radius.
+// Instead of storing the full 3D table (16 bytes per voxel), the table is built for one
+// z-plane at a time: for every (x,y) column the sum over the z-window [z-r, z+r] is kept and
+// a 2D summed-area table is built on top of these column sums. Moving the window from z to
+// z+1 only adds one plane and removes another, so the memory footprint is O(dimX * dimY).
+// For integer voxel types all sums are exact integer sums, so the result does not depend on
+// the evaluation order. Float volumes are summed in double precision, where sliding the window
+// would make the sums depend on the plane the window started at (and with that on the slabs
+// of a parallel extraction); for them, the column sums are summed up anew for every plane, in
+// the same order, which costs 2 * radius + 1 instead of 2 plane additions per plane.
+// The class is instantiated for uint8_t, uint16_t, int16_t, and float voxels
+template<typename T>
+class IntegralVolume {
+public:
+    // The type in which the sums of the values and the squared values are accumulated
+    typedef typename IntegralVolumeTraits<T>::Accumulator Accumulator;
+
+    // voxels: the voxel data in the usual x-fastest order
+    // dimensions: the dimensions of the volume
+    // radius: the box around a voxel extends 'radius' voxels in each direction
+    IntegralVolume(const T* voxels, const tgt::ivec3& dimensions, int radius);
+
+    // Centers the z-window on the plane z. For integer voxels, advancing to the next plane is
+    // cheap, jumping to any other plane rebuilds the column sums from scratch
+    void setPlane(int z);
+
+    // Computes the average and the standard deviation of the neighborhood of voxel (x, y)
+    // in the current plane. The neighborhood is clamped at the volume borders
+    void statistics(int x, int y, float& average, float& stdDeviation) const;
+
+    // Computes the statistics for all voxels in row y of the current plane; this is equal to
+    // calling statistics(x, y, ...) for every x, but reuses the row offsets into the tables
+    void rowStatistics(int y, float* averages, float* stdDeviations) const;
+
+private:
+    // Adds (sign = 1) or removes (sign = -1) the plane z to/from the column sums
+    void accumulatePlane(int z, int sign);
+    // Builds the 2D summed-area tables from the current column sums
+    void buildTables();
+
+    const T* _voxels;
+    tgt::ivec3 _dimensions;
+    int _radius;
+
+    int _plane; // The plane the window is currently centered on; -1 if there is none yet
+    int _zBegin; // The first plane in the window
+    int _zEnd; // One past the last plane in the window
+
+    std::vector<Accumulator> _columnSums; // Sum of the values per (x,y) column in the window
+    std::vector<Accumulator> _columnSquareSums; // Sum of the squared values per (x,y) column
+    std::vector<Accumulator> _sumTable; // (dimX+1) * (dimY+1) summed-area table of _columnSums
+    std::vector<Accumulator> _squareSumTable; // Summed-area table of _columnSquareSums
+};
+
+} // namespace voreen
+
+#endif // VRN_TNM_INTEGRALVOLUME_H
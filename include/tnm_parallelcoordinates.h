@@ -3,7 +3,14 @@
 
 #include "voreen/core/processors/renderprocessor.h"
 #include "voreen/core/properties/eventproperty.h"
+#include "voreen/core/properties/floatproperty.h"
+#include "voreen/core/properties/intproperty.h"
+#include "voreen/core/properties/optionproperty.h"
+#include "modules/tnm093/include/tnm_brushingworker.h"
+#include "modules/tnm093/include/tnm_columnbuffers.h"
 #include "modules/tnm093/include/tnm_common.h"
+#include "modules/tnm093/include/tnm_pickingtarget.h"
+#include "modules/tnm093/include/tnm_refinementtimer.h"
 #include "modules/tnm093/include/indexproperty.h"
 #include "tgt/vector.h"
 #include <utility>
@@ -11,7 +18,7 @@
 
 namespace voreen {
 
-class TNMParallelCoordinates : public RenderProcessor {
+class TNMParallelCoordinates : public RenderProcessor, public TNMFeatureConsumer {
 public:
     TNMParallelCoordinates();
     ~TNMParallelCoordinates();
@@ -21,6 +28,25 @@ public:
 
     Processor* create() const          { return new TNMParallelCoordinates; }
 
+	void initialize() throw (tgt::Exception);
+	void deinitialize() throw (tgt::Exception);
+
+	// The features that are shown on the axes
+	FeatureMask getRequiredFeatures() const;
+
+	// The ways the lines are drawn
+	enum RenderMode {
+		RENDER_LINES = 0, // Every item is drawn as a line
+		RENDER_DENSITY // The density of the lines between each pair of axes; linked lines are drawn on top
+	};
+
+	// The functions that map the number of lines in a bin to its intensity in the density mode
+	enum DensityCurve {
+		CURVE_LINEAR = 0, // Proportional to the number of lines
+		CURVE_LOGARITHMIC, // Proportional to the logarithm of the number of lines
+		CURVE_POWER // The relative number of lines to the power of the density exponent
+	};
+
 protected:
 	// This method gets called during each run of the rendering loop
     void process();
@@ -28,14 +54,53 @@ protected:
 	// Render the lines for the parallel coordinates plot
     void renderLines();
 
-	// Render the lines with picking information included in the color
+	// Render the lines with their ids into the picking target
 	void renderLinesPicking();
 
+	// Renders the ids of the handles and the lines into the picking target, unless it is
+	// still up to date; called by the mouse callbacks that need it
+	void renderPicking();
+
+	// Uploads the columns of the axes and the flags of the lines if they have changed
+	void updateBuffers(const Data& data);
+
+	// Draws all lines from the vertex buffers in one call, with the colors or the picking ids,
+	// or only the linked lines
+	void drawLines(bool picking, bool linkedOnly = false);
+
+	// Maps the counts of the latest histograms of the lines that are not brushed, one for every
+	// pair of adjacent axes, to intensities and uploads them into _densityTexture
+	void uploadDensity();
+
+	// Draws the bins of the histograms, see uploadDensity
+	void renderDensity();
+
+	// Called when the transfer curve of the density changes
+	void invalidateDensity();
+
+	// Releases the histograms, which are outdated after the lines mode
+	void dropDensity();
+
+	// Draws the cached content of 'layer' over the active target
+	void compositeLayer(RenderPort& layer);
+
+	// Makes process() render both layers again, e.g. after the mode or a handle has changed
+	void invalidateLayers();
+
+	// Passes the ranges of the handles to the brushing worker
+	void requestBrushing();
+
+	// Publishes the latest result of the brushing worker in _brushingIndices and polls for
+	// the next one while the worker is busy
+	void publishBrushing();
+
+	// Takes the brushed voxels and the histograms that the worker has finished, if any
+	void takeBrushing();
+
 	// Render the handles of the parallel coordinate axes
     void renderHandles();
 
-	// Render the handles of the parallel coordinates axes with picking information
-	// included in the color
+	// Render the handles of the parallel coordinates axes with their ids into the picking target
     void renderHandlesPicking();
 
 	// The callback method that gets called when a mouse button was clicked on the rendering
@@ -59,7 +124,7 @@ protected:
         };
 
 		// location: if the axis handle is on the top or bottom part of the axis
-		// index: a unique index that gets encoded in the red channel of the picking texture
+		// index: a unique index that is written to the first id of the picking target
 		// position: the position (in [-1,1]) where the axis handle will be drawn
         AxisHandle(AxisHandlePosition location, int index, const tgt::vec2& position);
         
@@ -72,8 +137,8 @@ protected:
 		// Renders the handle at the current position with the color meant for presentation
         void render() const;
 
-		// Renders the handle at the current position using the encoded picking color
-        void renderPicking() const;
+		// Renders the handle at the current position with its id; 'shader' has to be active
+        void renderPicking(tgt::Shader* shader) const;
 
 		// The current position of the handle
         tgt::vec2 _position;
@@ -96,9 +161,14 @@ private:
 	// The outport that will contain the rendering meant for the user
     RenderPort _outport;
 
-	// The picking port which will be rendered to with the encoded IDs
+	// The cached layers that are composited into the outport: all lines that are not brushed
+	// (or their density), and the linked lines on top of them
+    RenderPort _contextLayer;
+    RenderPort _linkedLayer;
+
+	// The picking target which will be rendered to with the ids of the handles and lines
 	// and which will be queried in the mouse callbacks
-    RenderPort _privatePort;
+    PickingTarget _pickingTarget;
 
 	// The event that registers the click event
     EventProperty<TNMParallelCoordinates>* _mouseClickEvent;
@@ -117,8 +187,35 @@ private:
 	IndexProperty _brushingIndices;  // A list of voxel indices that should be ignored in the rendering
 	IndexProperty _linkingIndices; // A list of voxel indices that should be enhanced during rendering
 
-	std::set<unsigned int> _brushingList; // The internal storage for the list of ignored voxels
-	std::set<unsigned int> _linkingList; // The internal storage for the list of selected voxels
+	IndexSet _brushingList; // The latest list of ignored voxels from _brushingWorker
+	IndexSet _linkingList; // The internal storage for the list of selected voxels
+
+	IntOptionProperty _renderMode; // One of RenderMode
+	IntProperty _densityBins; // The number of bins per axis of the histograms in the density mode
+	IntOptionProperty _densityCurve; // One of DensityCurve
+	FloatProperty _densityExponent; // The exponent for CURVE_POWER
+
+	tgt::Shader* _shader; // Draws the lines and handles the brushing with the handle ranges
+	tgt::Shader* _linePickingShader; // Draws the ids of the lines into the picking target
+	tgt::Shader* _handlePickingShader; // Draws the ids of the handles into the picking target
+	tgt::Shader* _densityShader; // Draws the bins of the histograms in the density mode
+	tgt::Shader* _layerShader; // Composites a layer into the outport
+	GLuint _densityTexture; // The intensities of the bins, see uploadDensity
+	int _densityTextureBins; // The number of bins per axis in _densityTexture
+	std::vector<uint32_t> _densityCounts; // The latest histograms from _brushingWorker
+	int _densityCountBins; // The number of bins per axis in _densityCounts
+	bool _densityValid; // If _densityTexture matches _densityCounts and the transfer curve
+
+	BrushingWorker _brushingWorker; // Resolves the brushed voxels for the handle ranges in the background
+	RefinementTimer _brushingTimer; // Calls process() again to take the next result of _brushingWorker
+	ColumnBuffers _axisBuffers; // The encoded values of the axes, one buffer per axis
+	GLuint _flagBuffer; // One byte of flags per line, see LINE_LINKED
+	bool _linkingChanged; // If _linkingList has changed since the flags were uploaded
+	bool _pickingValid; // If _pickingTarget matches the lines, the handles and the size of the outport
+	bool _linesPickable; // If the lines are drawn into the picking target; not in the density mode
+	bool _contextLayerValid; // If _contextLayer matches the lines, the handles and the mode
+	bool _linkedLayerValid; // If _linkedLayer matches the lines, the handles and the linked lines
+	tgt::ivec2 _layerSize; // The size of the outport for which the layers were rendered
 	
 	
 };
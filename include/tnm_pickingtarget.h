@@ -0,0 +1,59 @@
+#ifndef VRN_TNM_PICKINGTARGET_H
+#define VRN_TNM_PICKINGTARGET_H
+
+#include "tgt/gl.h"
+#include "tgt/vector.h"
+
+namespace voreen {
+
+// An offscreen render target for picking. Every pixel holds two 32-bit unsigned integer ids,
+// e.g. of the handle and of the line under it, with 0 meaning nothing, so the ids are exact
+// for any number of objects. Only the pixels around the cursor are read back: the transfer
+// goes into a pixel buffer object and is fenced, so requesting the ids returns immediately
+// and reading them only waits for a few bytes instead of downloading the whole target
+class PickingTarget {
+public:
+    PickingTarget();
+
+    // Creates the framebuffer and the pixel buffer; this needs an OpenGL context
+    void initialize();
+    void deinitialize();
+
+    // Reallocates the attachment if 'size' differs from the current size
+    void resize(const tgt::ivec2& size);
+    const tgt::ivec2& getSize() const { return _size; }
+
+    // Makes the target the destination of the rendering and clears it to 0. The shaders write
+    // the ids as a uvec2 to output 0
+    void activate();
+    // Restores the framebuffer and the viewport that were active before activate()
+    void deactivate();
+
+    // Starts reading the ids of the pixels within 'radius' of 'position' (in pixels, origin at
+    // the bottom left) into the pixel buffer, without waiting for the transfer
+    void requestIds(const tgt::ivec2& position, int radius = 0);
+    // Returns true if a request has been made and its transfer has finished
+    bool idsReady() const;
+    // Returns the ids of the last request, waiting for its transfer if necessary. Each of the
+    // two ids is taken from the pixel closest to the requested position where it is not 0.
+    // Returns false if there is no request
+    bool readIds(GLuint ids[2]);
+
+private:
+    GLuint _framebuffer;
+    GLuint _colorBuffer; // A GL_RG32UI renderbuffer
+    GLuint _pixelBuffer; // Receives the pixels of a request
+    tgt::ivec2 _size;
+
+    GLsync _fence; // Signaled when the transfer of the request is complete; 0 if there is none
+    tgt::ivec2 _requestOrigin; // The lower left pixel of the request
+    tgt::ivec2 _requestSize; // The number of requested pixels in x and y
+    tgt::ivec2 _requestPosition; // The requested position, relative to _requestOrigin
+
+    GLint _previousFramebuffer; // The binding that deactivate() restores
+    GLint _previousViewport[4];
+};
+
+} // namespace voreen
+
+#endif // VRN_TNM_PICKINGTARGET_H
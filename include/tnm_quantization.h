@@ -0,0 +1,99 @@
+#ifndef VRN_TNM_QUANTIZATION_H
+#define VRN_TNM_QUANTIZATION_H
+
+#include <stdint.h>
+#include <cstring>
+
+namespace voreen {
+
+// Conversions between 32-bit floats and the compact encodings of the feature values. All
+// feature values are normalized to [-1,1], so the fixed-point encodings map this range onto
+// the full range of the integer type
+
+// Converts a float into an IEEE 754 half float, rounding to the nearest even value. Values
+// that are too large become infinity, NaN stays NaN
+inline uint16_t floatToHalf(float value) {
+    const uint32_t F32_INFINITY = 255u << 23;
+    const uint32_t F16_MAX = (127u + 16u) << 23;
+    // Adding this value (as a float) shifts the mantissa of a small value to the position of
+    // a half float subnormal, letting the FPU do the rounding
+    const uint32_t DENORM_MAGIC = ((127u - 15u) + (23u - 10u) + 1u) << 23;
+
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    const uint32_t sign = bits & 0x80000000u;
+    bits ^= sign;
+
+    uint16_t result;
+    if (bits >= F16_MAX) {
+        result = (bits > F32_INFINITY) ? 0x7e00 : 0x7c00;
+    }
+    else if (bits < (113u << 23)) {
+        float magic;
+        std::memcpy(&magic, &DENORM_MAGIC, sizeof(magic));
+        float absolute;
+        std::memcpy(&absolute, &bits, sizeof(absolute));
+        absolute += magic;
+        std::memcpy(&bits, &absolute, sizeof(bits));
+        result = static_cast<uint16_t>(bits - DENORM_MAGIC);
+    }
+    else {
+        const uint32_t mantissaOdd = (bits >> 13) & 1;
+        bits += (static_cast<uint32_t>(15 - 127) << 23) + 0xfff;
+        bits += mantissaOdd;
+        result = static_cast<uint16_t>(bits >> 13);
+    }
+    return result | static_cast<uint16_t>(sign >> 16);
+}
+
+// Converts an IEEE 754 half float into a float; the conversion is exact
+inline float halfToFloat(uint16_t value) {
+    const uint32_t sign = static_cast<uint32_t>(value & 0x8000u) << 16;
+    uint32_t exponent = (value >> 10) & 0x1f;
+    uint32_t mantissa = value & 0x3ffu;
+
+    uint32_t bits;
+    if (exponent == 0) {
+        if (mantissa == 0) {
+            bits = sign;
+        }
+        else {
+            // Subnormal half floats are normal floats
+            exponent = 1;
+            while (!(mantissa & 0x400u)) {
+                mantissa <<= 1;
+                --exponent;
+            }
+            bits = sign | ((exponent + 112) << 23) | ((mantissa & 0x3ffu) << 13);
+        }
+    }
+    else if (exponent == 31) {
+        bits = sign | 0x7f800000u | (mantissa << 13);
+    }
+    else {
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    }
+
+    float result;
+    std::memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+// Maps a value in [-1,1] onto [0, maxCode]; values outside of the range are clamped
+inline uint32_t encodeFixed(float value, uint32_t maxCode) {
+    const float scaled = (value + 1.f) * 0.5f * maxCode + 0.5f;
+    if (!(scaled > 0.f))
+        return 0;
+    if (scaled >= maxCode)
+        return maxCode;
+    return static_cast<uint32_t>(scaled);
+}
+
+// Maps a code in [0, maxCode] back onto [-1,1]
+inline float decodeFixed(uint32_t code, uint32_t maxCode) {
+    return code * (2.f / maxCode) - 1.f;
+}
+
+} // namespace voreen
+
+#endif // VRN_TNM_QUANTIZATION_H
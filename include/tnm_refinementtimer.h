@@ -0,0 +1,41 @@
+#ifndef VRN_TNM_REFINEMENTTIMER_H
+#define VRN_TNM_REFINEMENTTIMER_H
+
+#include "tgt/event/eventhandler.h"
+#include "tgt/event/eventlistener.h"
+#include "tgt/timer.h"
+
+namespace voreen {
+
+class Processor;
+
+// Invalidates a processor shortly after it has been processed, so that a processor that
+// delivers its result in several steps is called again in one of the next frames. Calling
+// invalidate() from within process() does not work for this, because the network evaluator
+// marks the processor as valid once process() returns
+class RefinementTimer : public tgt::EventListener {
+public:
+    explicit RefinementTimer(Processor* processor);
+    ~RefinementTimer();
+
+    // Invalidates the processor after 'delay' milliseconds. Returns false if the application
+    // does not provide timers, in which case the processor has to deliver its complete result
+    bool schedule(int delay = 0);
+    // Discards a scheduled invalidation
+    void cancel();
+
+    void timerEvent(tgt::TimeEvent* e);
+
+private:
+    RefinementTimer(const RefinementTimer&);
+    RefinementTimer& operator=(const RefinementTimer&);
+
+    Processor* _processor; // The processor that is invalidated
+    tgt::EventHandler _eventHandler; // Receives the events of _timer and passes them to this object
+    tgt::Timer* _timer; // Created on first use, as the application might not exist before
+    bool _scheduled; // If an invalidation is pending
+};
+
+} // namespace voreen
+
+#endif // VRN_TNM_REFINEMENTTIMER_H
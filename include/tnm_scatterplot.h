@@ -2,13 +2,18 @@
 #define VRN_TNM_SCATTERPLOT_H
 
 #include "voreen/core/processors/renderprocessor.h"
+#include "voreen/core/properties/floatproperty.h"
+#include "voreen/core/properties/optionproperty.h"
+#include "modules/tnm093/include/tnm_columnbuffers.h"
 #include "modules/tnm093/include/tnm_common.h"
 #include "modules/tnm093/include/indexproperty.h"
 
+#include <vector>
+
 
 namespace voreen {
 
-class TNMScatterPlot : public RenderProcessor {
+class TNMScatterPlot : public RenderProcessor, public TNMFeatureConsumer {
 public:
     TNMScatterPlot();
     std::string getClassName() const   { return "TNMScatterPlot";           }
@@ -23,14 +28,54 @@ public:
 
 	bool isReady() const { return true; }
 
+	// The features on the two axes
+	FeatureMask getRequiredFeatures() const;
+
+	// The ways the points are drawn
+	enum RenderMode {
+		RENDER_POINTS = 0, // Every point is drawn
+		RENDER_DENSITY // The number of points per pixel with a color map; linked points are drawn on top
+	};
+
+	// The functions that map the number of points in a pixel to its intensity in the density mode
+	enum DensityCurve {
+		CURVE_LINEAR = 0, // Proportional to the number of points
+		CURVE_LOGARITHMIC, // Proportional to the logarithm of the number of points
+		CURVE_POWER // The relative number of points to the power of the density exponent
+	};
+
 protected:
     void process();
 
 private:
+	// Called when an axis changes, so that the extraction computes the newly shown feature
+	void requestFeatures();
+	// Called when the brushed or the linked voxels change
+	void invalidateBrushing();
+	void invalidateLinking();
+
+	// Brings the flags of the points up to date with the data and the brushed and linked voxels.
+	// Only the flags that have changed are uploaded. Returns true if the flags of points that
+	// were already drawn have changed, so the ranges of the axes have to be recomputed
+	bool updateFlags(const Data& data);
+	// Computes the mapping of the values of the points that are not brushed to [-1,1]
+	void updateRanges(const Data& data, const int* features);
+
+	// Bins the points that are not brushed into a 2D histogram with one bin per pixel of
+	// 'size' and uploads the intensities of the bins into _densityTexture
+	void computeDensity(const Data& data, const int* features, const tgt::ivec2& size);
+	// Draws the bins of the histogram with the color map, see computeDensity
+	void renderDensity();
+	// Collects the positions of the linked points that are not brushed into _linkedPointBuffer
+	void updateLinkedPoints();
+	// Called when a parameter of the density changes
+	void invalidateDensity();
+
     DataPort _inport; // The data that is to be rendered
     RenderPort _outport; // A wrapping class for multiple framebufferobjects that can be rendered to
 
 	tgt::Shader* _shader; // The shader object that will do the rendering for us
+	tgt::Shader* _densityShader; // Draws the bins of the histogram in the density mode
 
 	// A wrapper for an integer member variable that can be set using the GUI
     IntOptionProperty _firstAxis; 
@@ -38,6 +83,32 @@ private:
 
 	IndexProperty _brushingIndices; // A list of voxel indices that should be ignored in the rendering
 	IndexProperty _linkingIndices; // A list of voxel indices that should be enhanced during rendering
+
+	IntOptionProperty _renderMode; // One of RenderMode
+	IntOptionProperty _densityCurve; // One of DensityCurve
+	FloatProperty _densityExponent; // The exponent for CURVE_POWER
+
+	ColumnBuffers _axisBuffers; // The encoded values of the two axes
+
+	GLuint _flagBuffer; // One byte of flags per point, see POINT_BRUSHED and POINT_SELECTED
+	size_t _flagCapacity; // The number of flags that fit into _flagBuffer
+	std::vector<unsigned char> _flags; // The uploaded flags
+	Data _flaggedData; // The data that _flags belong to, to detect extensions of it
+	bool _brushingChanged; // If _brushingIndices has changed since the flags were computed
+	bool _linkingChanged; // If _linkingIndices has changed since the flags were computed
+
+	bool _rangesValid; // If _scale and _offset match the data, the axes and the brushed points
+	tgt::vec2 _scale; // Maps the values the shader receives to [-1,1]
+	tgt::vec2 _offset;
+	tgt::vec2 _valueScale; // Maps the decoded values to [-1,1]
+	tgt::vec2 _valueOffset;
+
+	GLuint _densityTexture; // The intensities of the bins, see computeDensity
+	bool _densityValid; // If _densityTexture matches the points, their ranges and the density parameters
+	tgt::ivec2 _densitySize; // The size of the outport for which the density was computed
+	GLuint _linkedPointBuffer; // The positions of the points that are drawn over the density
+	size_t _numLinkedPoints;
+	bool _linkedPointsValid; // If _linkedPointBuffer matches _flags
 };
 
 } // namespace
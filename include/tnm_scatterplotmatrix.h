@@ -0,0 +1,76 @@
+#ifndef VRN_TNM_SCATTERPLOTMATRIX_H
+#define VRN_TNM_SCATTERPLOTMATRIX_H
+
+#include "voreen/core/processors/renderprocessor.h"
+#include "modules/tnm093/include/tnm_columnbuffers.h"
+#include "modules/tnm093/include/tnm_common.h"
+#include "modules/tnm093/include/indexproperty.h"
+
+#include <vector>
+
+namespace voreen {
+
+// Shows the scatterplots of all pairs of the features that the data stores at once. The columns
+// of the features are uploaded once into vertex buffers and every cell of the matrix is one
+// instance of the same draw call, so switching between pairs never uploads anything. The cells
+// on the diagonal are left empty. Brushing and linking work like in TNMScatterPlot
+class TNMScatterPlotMatrix : public RenderProcessor, public TNMFeatureConsumer {
+public:
+    TNMScatterPlotMatrix();
+    std::string getClassName() const   { return "TNMScatterPlotMatrix";     }
+    std::string getCategory() const    { return "tnm093"               ; }
+    CodeState getCodeState() const     { return CODE_STATE_EXPERIMENTAL; }
+
+    Processor* create() const          { return new TNMScatterPlotMatrix;   }
+
+	void initialize() throw (tgt::Exception);
+	void deinitialize() throw (tgt::Exception);
+
+	bool isReady() const { return true; }
+
+	// All registered features
+	FeatureMask getRequiredFeatures() const;
+
+protected:
+    void process();
+
+private:
+	// Called when the brushed or the linked voxels change
+	void invalidateFlags();
+
+	// Brings the flags of the points up to date with the data and the brushed and linked voxels.
+	// Returns true if points that were flagged before have been brushed or unbrushed, which
+	// changes the ranges
+	bool updateFlags(const Data& data);
+	// Computes the mapping of the values of the points that are not brushed to [-1,1] for
+	// every feature in _features
+	void updateRanges(const Data& data);
+	// Draws the frames of the cells
+	void renderFrames() const;
+
+    DataPort _inport; // The data that is to be rendered
+    RenderPort _outport; // The matrix of scatterplots
+
+	tgt::Shader* _shader; // Draws the points of all cells
+	int _shaderFeatures; // The number of features _shader has been built for
+
+	IndexProperty _brushingIndices; // A list of voxel indices that should be ignored in the rendering
+	IndexProperty _linkingIndices; // A list of voxel indices that should be enhanced during rendering
+
+	std::vector<int> _features; // The features in the matrix, from the top and the left
+	ColumnBuffers _columnBuffers; // The encoded values of _features, one buffer per feature
+
+	GLuint _flagBuffer; // One byte of flags per point, see POINT_BRUSHED and POINT_SELECTED
+	size_t _flagCapacity; // The number of flags that fit into _flagBuffer
+	std::vector<unsigned char> _flags; // The uploaded flags
+	Data _flaggedData; // The data that _flags belong to
+	bool _flagsChanged; // If the brushed or linked voxels have changed since the flags were computed
+
+	bool _rangesValid; // If _scale and _offset match the data and the brushed points
+	std::vector<float> _scale; // Maps the values the shader receives to [-1,1], per feature
+	std::vector<float> _offset;
+};
+
+} // namespace
+
+#endif // VRN_TNM_SCATTERPLOTMATRIX_H
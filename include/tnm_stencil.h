@@ -0,0 +1,37 @@
+#ifndef VRN_TNM_STENCIL_H
+#define VRN_TNM_STENCIL_H
+
+#include <stdint.h>
+#include <cstddef>
+
+namespace voreen {
+
+// Row-wise kernels used by the feature extraction. All of them process a complete row of
+// voxels (along x, which is the fastest running index in memory) at once, so that the
+// memory is read sequentially and several x positions are computed in one SIMD register.
+// On x86, AVX is used if the processor supports it at run time and SSE2 if the build targets
+// it; otherwise a scalar implementation is used that produces the same results
+
+// Converts 'count' voxel values into floating point values; there is one overload for every
+// supported voxel type
+void convertToFloat(const uint8_t* source, size_t count, float* destination);
+void convertToFloat(const uint16_t* source, size_t count, float* destination);
+void convertToFloat(const int16_t* source, size_t count, float* destination);
+void convertToFloat(const float* source, size_t count, float* destination);
+
+// Computes the magnitude of the central-difference gradient for every voxel of a row.
+// row is the row itself, rowYMinus/rowYPlus are the neighboring rows in y and
+// rowZMinus/rowZPlus the rows at the same y in the neighboring planes. At the borders of the
+// volume, the neighboring row is replaced by the row itself, which results in a one-sided
+// difference. In x the same is done by the kernel
+void gradientMagnitudeRow(const float* row, const float* rowYMinus, const float* rowYPlus,
+                          const float* rowZMinus, const float* rowZPlus, int dimX, float* result);
+
+// Computes the 6-neighborhood Laplacian for every voxel of a row. The parameters and the
+// border handling are the same as for gradientMagnitudeRow
+void laplacianRow(const float* row, const float* rowYMinus, const float* rowYPlus,
+                  const float* rowZMinus, const float* rowZPlus, int dimX, float* result);
+
+} // namespace voreen
+
+#endif // VRN_TNM_STENCIL_H
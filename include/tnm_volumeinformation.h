@@ -5,7 +5,14 @@
 #include <cmath>
 
 #include "voreen/core/processors/processor.h"
+#include "voreen/core/properties/boolproperty.h"
+#include "voreen/core/properties/filedialogproperty.h"
+#include "voreen/core/properties/intproperty.h"
+#include "voreen/core/properties/optionproperty.h"
 #include "modules/tnm093/include/tnm_common.h"
+#include "modules/tnm093/include/tnm_featurecache.h"
+#include "modules/tnm093/include/tnm_refinementtimer.h"
+#include "modules/tnm093/include/tnm_volumeslabreader.h"
 
 namespace voreen {
 
@@ -23,10 +30,48 @@ protected:
     void process();
 
 private:
+    // Computes the measures for a volume that is in memory and publishes them on the outport
+    template<typename T>
+    void extractMeasures(const VolumeAtomic<T>* volume);
+
+    // Computes 'features' for a subset of the planes of the volume and publishes them as a
+    // preview while the complete extraction is pending
+    template<typename T>
+    void extractPreview(const VolumeAtomic<T>* volume, FeatureMask features);
+
+    // Selects the slab reader for the voxel type and location (disk or memory) of the volume
+    // and runs the streaming extraction
+    void processStreaming(const VolumeHandleBase* volumeHandle);
+
+    // Computes the measures slab by slab within the memory budget; the full resolution
+    // measures are written to _streamingFile and a subsample is published on the outport
+    template<typename T>
+    void streamMeasures(const VolumeSlabReader<T>& reader);
+
     VolumePort _inport; // The inport that contains the volume for which the information is computed
     DataPort _outport; // The outport containing the computed measures
 
+    IntProperty _numThreads; // The number of threads used for the extraction; 0 uses all available cores
+    IntProperty _neighborhoodRadius; // The radius of the box used for the average and standard deviation
+
+    BoolProperty _useCache; // If enabled, the computed measures are stored on disk and reused for the same volume
+    FileDialogProperty _cacheDirectory; // The directory where the cached measures are stored
+    IntProperty _cacheSizeLimit; // The maximum size of all cached measures in megabytes
+
+    BoolProperty _streaming; // If enabled, the volume is processed in slabs without keeping all measures in memory
+    IntProperty _memoryBudget; // The memory in megabytes the streaming extraction may use
+    FileDialogProperty _streamingFile; // The file the streaming extraction writes the measures to
+
+    IntOptionProperty _encoding; // The Data::Encoding in which the measures are published
+
+    BoolProperty _progressive; // If a preview is published before the measures of a new volume are extracted
+    RefinementTimer _refinementTimer; // Calls process() again for the complete extraction after the preview
+
+    FeatureCache _featureCache; // The on-disk cache of previously computed measures
+
     Data* _data; // The local copy of the computed data; ownership stays with this object at all times
+    FeatureMask _computedFeatures; // The features that are valid in _data
+    int _computedRadius; // The neighborhood radius that was used for the features in _data
 };
 
 } // namespace
@@ -0,0 +1,60 @@
+#ifndef VRN_TNM_VOLUMESLABREADER_H
+#define VRN_TNM_VOLUMESLABREADER_H
+
+#include "voreen/core/datastructures/volume/volumeatomic.h"
+#include "tgt/vector.h"
+
+#include <stdint.h>
+#include <string>
+
+namespace voreen {
+
+// Provides the voxels of a volume one slab (a range of z-planes) at a time, so that the
+// streaming extraction never needs the full volume in memory. readPlanes may be called
+// concurrently from multiple threads. T is the voxel type; the readers are instantiated for
+// uint8_t, uint16_t, int16_t, and float
+template<typename T>
+class VolumeSlabReader {
+public:
+    virtual ~VolumeSlabReader() {}
+
+    // Returns the dimensions of the complete volume
+    virtual tgt::ivec3 getDimensions() const = 0;
+
+    // Copies the planes [zBegin, zEnd) into 'destination', which has to have room for
+    // (zEnd - zBegin) * dimX * dimY voxels. Returns false if the planes could not be read
+    virtual bool readPlanes(int zBegin, int zEnd, T* destination) const = 0;
+};
+
+// Reads the slabs from a volume that already resides in main memory
+template<typename T>
+class MemorySlabReader : public VolumeSlabReader<T> {
+public:
+    MemorySlabReader(const VolumeAtomic<T>* volume);
+
+    tgt::ivec3 getDimensions() const;
+    bool readPlanes(int zBegin, int zEnd, T* destination) const;
+
+private:
+    const VolumeAtomic<T>* _volume;
+};
+
+// Reads the slabs directly from a raw file on disk in which the voxels are stored in the
+// native byte order in x-fastest order, starting at 'offset' bytes
+template<typename T>
+class RawFileSlabReader : public VolumeSlabReader<T> {
+public:
+    RawFileSlabReader(const std::string& fileName, const tgt::ivec3& dimensions, uint64_t offset);
+
+    tgt::ivec3 getDimensions() const;
+    bool readPlanes(int zBegin, int zEnd, T* destination) const;
+
+private:
+    std::string _fileName;
+    tgt::ivec3 _dimensions;
+    uint64_t _offset;
+};
+
+} // namespace voreen
+
+#endif // VRN_TNM_VOLUMESLABREADER_H
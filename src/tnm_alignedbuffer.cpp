@@ -0,0 +1,110 @@
+#include "modules/tnm093/include/tnm_alignedbuffer.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+namespace voreen {
+
+namespace {
+    // Allocates 'size' bytes aligned to AlignedBuffer::ALIGNMENT; throws std::bad_alloc on failure
+    unsigned char* allocateAligned(size_t size) {
+#ifdef _WIN32
+        void* memory = _aligned_malloc(size, AlignedBuffer::ALIGNMENT);
+#else
+        void* memory = 0;
+        if (posix_memalign(&memory, AlignedBuffer::ALIGNMENT, size) != 0)
+            memory = 0;
+#endif
+        if (memory == 0)
+            throw std::bad_alloc();
+        return static_cast<unsigned char*>(memory);
+    }
+
+    void freeAligned(unsigned char* memory) {
+#ifdef _WIN32
+        _aligned_free(memory);
+#else
+        std::free(memory);
+#endif
+    }
+
+    size_t padToAlignment(size_t size) {
+        return (size + AlignedBuffer::ALIGNMENT - 1) / AlignedBuffer::ALIGNMENT * AlignedBuffer::ALIGNMENT;
+    }
+}
+
+AlignedBuffer::AlignedBuffer()
+    : _data(0)
+    , _size(0)
+    , _capacity(0)
+{}
+
+AlignedBuffer::AlignedBuffer(const AlignedBuffer& other)
+    : _data(0)
+    , _size(0)
+    , _capacity(0)
+{
+    resize(other._size);
+    if (_size > 0)
+        std::memcpy(_data, other._data, _size);
+}
+
+AlignedBuffer::~AlignedBuffer() {
+    if (_data)
+        freeAligned(_data);
+}
+
+AlignedBuffer& AlignedBuffer::operator=(const AlignedBuffer& other) {
+    if (this != &other) {
+        AlignedBuffer copy(other);
+        swap(copy);
+    }
+    return *this;
+}
+
+void AlignedBuffer::swap(AlignedBuffer& other) {
+    std::swap(_data, other._data);
+    std::swap(_size, other._size);
+    std::swap(_capacity, other._capacity);
+}
+
+void AlignedBuffer::resize(size_t size) {
+    // Like append(), growing resizes double the capacity, so that growing one item at a time
+    // (e.g. Data::push_back) does not copy the buffer for every few items
+    if (size > _capacity)
+        reserve(std::max(size, 2 * _capacity));
+    if (size > _size)
+        std::memset(_data + _size, 0, size - _size);
+    _size = size;
+}
+
+void AlignedBuffer::reserve(size_t capacity) {
+    if (capacity <= _capacity)
+        return;
+
+    const size_t newCapacity = padToAlignment(capacity);
+    unsigned char* newData = allocateAligned(newCapacity);
+    if (_data) {
+        std::memcpy(newData, _data, _size);
+        freeAligned(_data);
+    }
+    _data = newData;
+    _capacity = newCapacity;
+}
+
+void AlignedBuffer::append(const unsigned char* bytes, size_t count) {
+    if (count == 0)
+        return;
+    if (_size + count > _capacity)
+        reserve(std::max(_size + count, 2 * _capacity));
+    std::memcpy(_data + _size, bytes, count);
+    _size += count;
+}
+
+} // namespace voreen
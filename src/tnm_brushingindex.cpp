@@ -0,0 +1,120 @@
+#include "modules/tnm093/include/tnm_brushingindex.h"
+
+#include <algorithm>
+
+namespace voreen {
+
+namespace {
+    // Orders the positions of the items by their value
+    class ByValue {
+    public:
+        ByValue(const std::vector<float>& values) : _values(values) {}
+        bool operator()(uint32_t lhs, uint32_t rhs) const { return _values[lhs] < _values[rhs]; }
+    private:
+        const std::vector<float>& _values;
+    };
+
+    inline bool isInside(float value, float lower, float upper) {
+        return (value >= lower) && (value <= upper);
+    }
+}
+
+BrushingIndex::BrushingIndex() {}
+
+void BrushingIndex::build(const Data& data, const int* features, int numAxes, const float* lower, const float* upper) {
+    const size_t numItems = data.size();
+    _axes.assign(numAxes, Axis());
+    _violations.assign(numItems, 0);
+
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic)
+#endif
+    for (int k = 0; k < numAxes; ++k) {
+        Axis& axis = _axes[k];
+        axis.lower = lower[k];
+        axis.upper = upper[k];
+
+        // A value that is not a number (the extraction produces them for constant features)
+        // would break the ordering. Like in the range test of the shader, where every
+        // comparison with it is false, it never violates a range, so it is left out of the axis
+        std::vector<float> values(numItems);
+        if (numItems > 0)
+            data.getValues(features[k], 0, numItems, &values[0]);
+
+        axis.order.reserve(numItems);
+        for (size_t i = 0; i < numItems; ++i) {
+            if (values[i] == values[i])
+                axis.order.push_back(static_cast<uint32_t>(i));
+        }
+        std::sort(axis.order.begin(), axis.order.end(), ByValue(values));
+        axis.sortedValues.resize(axis.order.size());
+        for (size_t i = 0; i < axis.order.size(); ++i)
+            axis.sortedValues[i] = values[axis.order[i]];
+    }
+
+    // The items below and above the range of each axis violate it
+    for (int k = 0; k < numAxes; ++k) {
+        const Axis& axis = _axes[k];
+        const size_t numValues = axis.sortedValues.size();
+        const size_t begin = std::lower_bound(axis.sortedValues.begin(), axis.sortedValues.end(), axis.lower) - axis.sortedValues.begin();
+        const size_t end = std::upper_bound(axis.sortedValues.begin(), axis.sortedValues.end(), axis.upper) - axis.sortedValues.begin();
+        for (size_t i = 0; i < std::min(begin, numValues); ++i)
+            ++_violations[axis.order[i]];
+        for (size_t i = std::max(begin, end); i < numValues; ++i)
+            ++_violations[axis.order[i]];
+    }
+}
+
+void BrushingIndex::clear() {
+    std::vector<Axis>().swap(_axes);
+    std::vector<uint8_t>().swap(_violations);
+}
+
+void BrushingIndex::setRange(int axis, float lower, float upper, std::vector<size_t>& brushed, std::vector<size_t>& unbrushed) {
+    Axis& a = _axes[axis];
+    const float oldLower = a.lower;
+    const float oldUpper = a.upper;
+    a.lower = lower;
+    a.upper = upper;
+
+    // Only items between the old and the new lower bound, or between the old and the new upper
+    // bound, can change their state. If the two intervals overlap, they are visited together
+    const float lowFrom = std::min(oldLower, lower);
+    const float lowTo = std::max(oldLower, lower);
+    const float highFrom = std::min(oldUpper, upper);
+    const float highTo = std::max(oldUpper, upper);
+    if (lowTo >= highFrom) {
+        update(axis, lowFrom, highTo, oldLower, oldUpper, brushed, unbrushed);
+    }
+    else {
+        update(axis, lowFrom, lowTo, oldLower, oldUpper, brushed, unbrushed);
+        update(axis, highFrom, highTo, oldLower, oldUpper, brushed, unbrushed);
+    }
+}
+
+void BrushingIndex::update(int axis, float from, float to, float oldLower, float oldUpper,
+                           std::vector<size_t>& brushed, std::vector<size_t>& unbrushed)
+{
+    const Axis& a = _axes[axis];
+    const size_t begin = std::lower_bound(a.sortedValues.begin(), a.sortedValues.end(), from) - a.sortedValues.begin();
+    const size_t end = std::upper_bound(a.sortedValues.begin(), a.sortedValues.end(), to) - a.sortedValues.begin();
+    for (size_t i = begin; i < end; ++i) {
+        const float value = a.sortedValues[i];
+        const bool wasInside = isInside(value, oldLower, oldUpper);
+        const bool inside = isInside(value, a.lower, a.upper);
+        if (wasInside == inside)
+            continue;
+
+        const size_t item = a.order[i];
+        if (inside) {
+            if (--_violations[item] == 0)
+                unbrushed.push_back(item);
+        }
+        else {
+            if (_violations[item]++ == 0)
+                brushed.push_back(item);
+        }
+    }
+}
+
+} // namespace voreen
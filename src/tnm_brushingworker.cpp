@@ -0,0 +1,422 @@
+#include "modules/tnm093/include/tnm_brushingworker.h"
+
+#include <algorithm>
+
+#ifdef _MSC_VER
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+namespace voreen {
+
+struct BrushingWorker::Threading {
+#ifdef _MSC_VER
+    HANDLE thread;
+    CRITICAL_SECTION mutex;
+    CONDITION_VARIABLE condition;
+
+    static DWORD WINAPI threadFunction(LPVOID worker) {
+        static_cast<BrushingWorker*>(worker)->run();
+        return 0;
+    }
+#else
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t condition;
+
+    static void* threadFunction(void* worker) {
+        static_cast<BrushingWorker*>(worker)->run();
+        return 0;
+    }
+#endif
+};
+
+namespace {
+    // The number of items after which a long computation checks whether it has been canceled
+    const size_t CANCEL_CHECK_INTERVAL = 65536;
+
+    // The number of values per axis that are decoded at once for the histograms
+    const size_t DECODE_BLOCK_SIZE = 4096;
+
+    // Returns the bin of 'numBins' bins over [-1,1] that contains 'value'
+    inline int densityBin(float value, int numBins) {
+        const int bin = static_cast<int>((value + 1.f) * 0.5f * numBins);
+        return std::max(0, std::min(bin, numBins - 1));
+    }
+}
+
+BrushingWorker::BrushingWorker()
+    : _hasPendingData(false)
+    , _requestBins(0)
+    , _hasRequest(false)
+    , _computing(false)
+    , _hasResult(false)
+    , _densityResultBins(0)
+    , _hasDensityResult(false)
+    , _stopping(false)
+    , _running(false)
+    , _indexValid(false)
+    , _countBins(0)
+    , _threading(new Threading)
+{
+#ifdef _MSC_VER
+    _threading->thread = 0;
+    InitializeCriticalSection(&_threading->mutex);
+    InitializeConditionVariable(&_threading->condition);
+#else
+    pthread_mutex_init(&_threading->mutex, 0);
+    pthread_cond_init(&_threading->condition, 0);
+#endif
+}
+
+BrushingWorker::~BrushingWorker() {
+    stop();
+#ifdef _MSC_VER
+    DeleteCriticalSection(&_threading->mutex);
+#else
+    pthread_cond_destroy(&_threading->condition);
+    pthread_mutex_destroy(&_threading->mutex);
+#endif
+    delete _threading;
+}
+
+void BrushingWorker::start() {
+    if (_running)
+        return;
+    _stopping = false;
+#ifdef _MSC_VER
+    _threading->thread = CreateThread(0, 0, &Threading::threadFunction, this, 0, 0);
+    _running = (_threading->thread != 0);
+#else
+    _running = (pthread_create(&_threading->thread, 0, &Threading::threadFunction, this) == 0);
+#endif
+}
+
+void BrushingWorker::stop() {
+    if (!_running)
+        return;
+    lock();
+    _stopping = true;
+    notify();
+    unlock();
+#ifdef _MSC_VER
+    WaitForSingleObject(_threading->thread, INFINITE);
+    CloseHandle(_threading->thread);
+    _threading->thread = 0;
+#else
+    pthread_join(_threading->thread, 0);
+#endif
+    _running = false;
+
+    // The thread has exited, so its state can be released here
+    _pendingData = Data();
+    _hasPendingData = false;
+    _hasRequest = false;
+    _data = Data();
+    _index.clear();
+    _indexValid = false;
+    _brushed.clear();
+    std::vector<uint32_t>().swap(_counts);
+    _countBins = 0;
+}
+
+void BrushingWorker::setData(const Data& data, const int* features, int numAxes) {
+    lock();
+    _pendingData = data;
+    _pendingFeatures.assign(features, features + numAxes);
+    _hasPendingData = true;
+    // The latest ranges are computed again for the new data
+    if (!_requestLower.empty())
+        _hasRequest = true;
+    notify();
+    unlock();
+}
+
+void BrushingWorker::request(const float* lower, const float* upper, int numAxes) {
+    lock();
+    _requestLower.assign(lower, lower + numAxes);
+    _requestUpper.assign(upper, upper + numAxes);
+    _hasRequest = true;
+    notify();
+    unlock();
+}
+
+void BrushingWorker::setDensityBins(int numBins) {
+    lock();
+    if (numBins != _requestBins) {
+        _requestBins = numBins;
+        if (!_requestLower.empty())
+            _hasRequest = true;
+        notify();
+    }
+    unlock();
+}
+
+bool BrushingWorker::takeResult(IndexSet& result) {
+    lock();
+    const bool hasResult = _hasResult;
+    if (hasResult)
+        result = _result;
+    _hasResult = false;
+    unlock();
+    return hasResult;
+}
+
+bool BrushingWorker::takeDensity(std::vector<uint32_t>& counts, int& numBins) {
+    lock();
+    const bool hasResult = _hasDensityResult;
+    if (hasResult) {
+        counts.swap(_densityResult);
+        numBins = _densityResultBins;
+    }
+    _hasDensityResult = false;
+    unlock();
+    return hasResult;
+}
+
+bool BrushingWorker::isBusy() const {
+    lock();
+    const bool busy = _hasRequest || _computing;
+    unlock();
+    return busy;
+}
+
+void BrushingWorker::waitUntilIdle() {
+    lock();
+    while (_running && (_hasRequest || _computing))
+        wait();
+    unlock();
+}
+
+void BrushingWorker::run() {
+    lock();
+    for (;;) {
+        while (!_stopping && !_hasRequest)
+            wait();
+        if (_stopping)
+            break;
+
+        // Only the latest request is computed; the ones it replaced are never started
+        if (_hasPendingData) {
+            _data = _pendingData;
+            _features = _pendingFeatures;
+            _pendingData = Data();
+            _hasPendingData = false;
+            _indexValid = false;
+        }
+        const std::vector<float> lower = _requestLower;
+        const std::vector<float> upper = _requestUpper;
+        const int numBins = _requestBins;
+        _hasRequest = false;
+        _computing = true;
+        unlock();
+
+        const bool finished = compute(lower, upper, numBins);
+        // The histograms are copied outside of the lock, as they can be large
+        std::vector<uint32_t> counts;
+        if (finished && numBins > 0)
+            counts = _counts;
+
+        lock();
+        if (finished) {
+            // The copy shares the containers with _brushed; the next update only copies the
+            // chunks it changes
+            _result = _brushed;
+            _hasResult = true;
+            if (numBins > 0) {
+                _densityResult.swap(counts);
+                _densityResultBins = numBins;
+                _hasDensityResult = true;
+            }
+        }
+        _computing = false;
+        notify();
+    }
+    unlock();
+}
+
+bool BrushingWorker::compute(const std::vector<float>& lower, const std::vector<float>& upper, int numBins) {
+    const int numAxes = static_cast<int>(_features.size());
+    if (numAxes == 0 || lower.size() != _features.size()) {
+        _brushed.clear();
+        _counts.assign(std::max(numAxes - 1, 0) * numBins * numBins, 0);
+        _countBins = 0;
+        return true;
+    }
+
+    if (!_indexValid) {
+        // New data: the index is built with the requested ranges and all brushed items are collected
+        _brushed.clear();
+        _index.build(_data, &_features[0], numAxes, &lower[0], &upper[0]);
+        if (isCanceled())
+            return false;
+        std::vector<size_t> brushed;
+        for (size_t i = 0; i < _index.size(); ++i) {
+            if (_index.isBrushed(i))
+                brushed.push_back(i);
+        }
+        setBrushed(brushed, true);
+        _indexValid = true;
+        _countBins = 0;
+    }
+    else {
+        // Only the axes whose range has changed are updated; the index only visits the items
+        // between the old and the new bounds
+        for (int k = 0; k < numAxes; ++k) {
+            if (lower[k] == _lower[k] && upper[k] == _upper[k])
+                continue;
+            std::vector<size_t> brushed;
+            std::vector<size_t> unbrushed;
+            _index.setRange(k, lower[k], upper[k], brushed, unbrushed);
+            if (_countBins > 0) {
+                updateDensity(brushed, -1);
+                updateDensity(unbrushed, 1);
+            }
+            setBrushed(brushed, true);
+            setBrushed(unbrushed, false);
+        }
+    }
+    _lower = lower;
+    _upper = upper;
+
+    // The histograms are only counted from scratch for new data or a new number of bins
+    if (numBins != _countBins && !isCanceled()) {
+        if (numBins > 0)
+            countDensity(numBins);
+        else
+            std::vector<uint32_t>().swap(_counts);
+        _countBins = numBins;
+    }
+
+    // A canceled computation leaves _brushed incomplete, but new data rebuilds it anyway
+    if (isCanceled())
+        return false;
+    // Large brushed regions consist of runs of voxels, which are stored compactly after this
+    _brushed.optimize();
+    return true;
+}
+
+void BrushingWorker::setBrushed(const std::vector<size_t>& positions, bool brushed) {
+    // An aggregated item stands for all voxels of its super-voxel
+    std::vector<VoxelIndex> members;
+    for (size_t i = 0; i < positions.size(); ++i) {
+        if ((i + 1) % CANCEL_CHECK_INTERVAL == 0 && isCanceled())
+            return;
+        _data.getMemberVoxels(_data.getVoxelIndex(positions[i]), members);
+        for (size_t j = 0; j < members.size(); ++j) {
+            if (brushed)
+                _brushed.insert(members[j]);
+            else
+                _brushed.erase(members[j]);
+        }
+    }
+}
+
+void BrushingWorker::countDensity(int numBins) {
+    const int numAxes = static_cast<int>(_features.size());
+    const int numPairs = numAxes - 1;
+    const size_t histogramSize = static_cast<size_t>(numBins) * numBins;
+    const size_t numItems = _data.size();
+    const int numBlocks = static_cast<int>((numItems + DECODE_BLOCK_SIZE - 1) / DECODE_BLOCK_SIZE);
+
+    // Every thread bins its blocks of items into histograms of its own, which are added up
+    // at the end, so the result does not depend on the number of threads
+    _counts.assign(numPairs * histogramSize, 0);
+#ifdef _OPENMP
+    #pragma omp parallel
+#endif
+    {
+        std::vector<uint32_t> localCounts(numPairs * histogramSize, 0);
+        std::vector<float> values(numAxes * DECODE_BLOCK_SIZE);
+#ifdef _OPENMP
+        #pragma omp for schedule(static)
+#endif
+        for (int block = 0; block < numBlocks; ++block) {
+            const size_t begin = block * DECODE_BLOCK_SIZE;
+            const size_t count = std::min(DECODE_BLOCK_SIZE, numItems - begin);
+            for (int k = 0; k < numAxes; ++k)
+                _data.getValues(_features[k], begin, count, &values[k * DECODE_BLOCK_SIZE]);
+
+            for (size_t i = 0; i < count; ++i) {
+                // Brushed lines are not counted, like in the line mode
+                if (_index.isBrushed(begin + i))
+                    continue;
+                int leftBin = densityBin(values[i], numBins);
+                for (int pair = 0; pair < numPairs; ++pair) {
+                    const int rightBin = densityBin(values[(pair + 1) * DECODE_BLOCK_SIZE + i], numBins);
+                    ++localCounts[pair * histogramSize + leftBin * numBins + rightBin];
+                    leftBin = rightBin;
+                }
+            }
+        }
+#ifdef _OPENMP
+        #pragma omp critical(BrushingWorker_mergeDensity)
+#endif
+        {
+            for (size_t j = 0; j < _counts.size(); ++j)
+                _counts[j] += localCounts[j];
+        }
+    }
+}
+
+void BrushingWorker::updateDensity(const std::vector<size_t>& positions, int sign) {
+    const int numAxes = static_cast<int>(_features.size());
+    const size_t histogramSize = static_cast<size_t>(_countBins) * _countBins;
+    for (size_t i = 0; i < positions.size(); ++i) {
+        const size_t item = positions[i];
+        int leftBin = densityBin(_data.getValue(item, _features[0]), _countBins);
+        for (int pair = 0; pair < numAxes - 1; ++pair) {
+            const int rightBin = densityBin(_data.getValue(item, _features[pair + 1]), _countBins);
+            _counts[pair * histogramSize + leftBin * _countBins + rightBin] += sign;
+            leftBin = rightBin;
+        }
+    }
+}
+
+bool BrushingWorker::isCanceled() const {
+    lock();
+    const bool canceled = _hasPendingData || _stopping;
+    unlock();
+    return canceled;
+}
+
+void BrushingWorker::lock() const {
+#ifdef _MSC_VER
+    EnterCriticalSection(&_threading->mutex);
+#else
+    pthread_mutex_lock(&_threading->mutex);
+#endif
+}
+
+void BrushingWorker::unlock() const {
+#ifdef _MSC_VER
+    LeaveCriticalSection(&_threading->mutex);
+#else
+    pthread_mutex_unlock(&_threading->mutex);
+#endif
+}
+
+void BrushingWorker::wait() const {
+#ifdef _MSC_VER
+    SleepConditionVariableCS(&_threading->condition, &_threading->mutex, INFINITE);
+#else
+    pthread_cond_wait(&_threading->condition, &_threading->mutex);
+#endif
+}
+
+void BrushingWorker::notify() const {
+#ifdef _MSC_VER
+    WakeAllConditionVariable(&_threading->condition);
+#else
+    pthread_cond_broadcast(&_threading->condition);
+#endif
+}
+
+} // namespace voreen
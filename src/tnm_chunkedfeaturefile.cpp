@@ -0,0 +1,98 @@
+#include "modules/tnm093/include/tnm_chunkedfeaturefile.h"
+
+#include <cstring>
+
+namespace voreen {
+
+namespace {
+    const uint32_t CHUNKED_FORMAT_VERSION = 3;
+    const char CHUNKED_MAGIC[8] = { 'T', 'N', 'M', 'C', 'H', 'N', 'K', '\0' };
+
+    struct ChunkedFileHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t valueSize; // The number of bytes per value
+        int32_t dimensions[3];
+        int32_t numValues; // NUM_DATA_VALUES of the writer
+        uint32_t features; // The FeatureMask of the features that are stored in the chunks
+        uint32_t padding;
+        uint64_t numChunks;
+        uint64_t numItems;
+        float minValues[NUM_DATA_VALUES];
+        float maxValues[NUM_DATA_VALUES];
+    };
+
+    struct ChunkHeader {
+        uint64_t firstIndex;
+        uint64_t numItems;
+    };
+
+    ChunkedFileHeader createHeader(const tgt::ivec3& dimensions, FeatureMask features,
+                                   uint64_t numChunks, uint64_t numItems)
+    {
+        ChunkedFileHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, CHUNKED_MAGIC, sizeof(CHUNKED_MAGIC));
+        header.version = CHUNKED_FORMAT_VERSION;
+        header.valueSize = sizeof(float);
+        header.dimensions[0] = dimensions.x;
+        header.dimensions[1] = dimensions.y;
+        header.dimensions[2] = dimensions.z;
+        header.numValues = NUM_DATA_VALUES;
+        header.features = features;
+        header.numChunks = numChunks;
+        header.numItems = numItems;
+        return header;
+    }
+}
+
+ChunkedFeatureWriter::ChunkedFeatureWriter()
+    : _dimensions(0)
+    , _features(0)
+    , _numChunks(0)
+    , _numItems(0)
+{}
+
+ChunkedFeatureWriter::~ChunkedFeatureWriter() {
+    if (_file.is_open())
+        _file.close();
+}
+
+bool ChunkedFeatureWriter::open(const std::string& fileName, const tgt::ivec3& dimensions, FeatureMask features) {
+    _dimensions = dimensions;
+    _features = features;
+    _numChunks = 0;
+    _numItems = 0;
+    _file.open(fileName.c_str(), std::ios::binary | std::ios::trunc);
+
+    // The header is written again with the final values in close()
+    const ChunkedFileHeader header = createHeader(dimensions, features, 0, 0);
+    _file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    return _file.good();
+}
+
+bool ChunkedFeatureWriter::writeChunk(VoxelIndex firstIndex, const float* const* columns, size_t count) {
+    ChunkHeader chunk;
+    chunk.firstIndex = firstIndex;
+    chunk.numItems = count;
+    _file.write(reinterpret_cast<const char*>(&chunk), sizeof(chunk));
+    for (int k = 0; k < NUM_FEATURES; ++k) {
+        if (_features & featureBit(k))
+            _file.write(reinterpret_cast<const char*>(columns[k]), static_cast<std::streamsize>(count * sizeof(float)));
+    }
+    _numChunks++;
+    _numItems += count;
+    return _file.good();
+}
+
+bool ChunkedFeatureWriter::close(const float* minValues, const float* maxValues) {
+    ChunkedFileHeader header = createHeader(_dimensions, _features, _numChunks, _numItems);
+    std::memcpy(header.minValues, minValues, sizeof(header.minValues));
+    std::memcpy(header.maxValues, maxValues, sizeof(header.maxValues));
+    _file.seekp(0);
+    _file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    _file.close();
+    return !_file.fail();
+}
+
+} // namespace voreen
@@ -0,0 +1,96 @@
+#include "modules/tnm093/include/tnm_columnbuffers.h"
+
+#include <algorithm>
+
+namespace voreen {
+
+ColumnBuffers::ColumnBuffers()
+    : _capacity(0)
+{}
+
+void ColumnBuffers::initialize(int count) {
+    _buffers.resize(count, 0);
+    _features.assign(count, -1);
+    glGenBuffers(count, &_buffers[0]);
+}
+
+void ColumnBuffers::deinitialize() {
+    if (!_buffers.empty())
+        glDeleteBuffers(static_cast<GLsizei>(_buffers.size()), &_buffers[0]);
+    _buffers.clear();
+    _features.clear();
+    _capacity = 0;
+    _data = Data();
+}
+
+size_t ColumnBuffers::update(const Data& data, const int* features) {
+    const bool sameFeatures = std::equal(_features.begin(), _features.end(), features);
+    const size_t firstNew = (sameFeatures && data.extends(_data)) ? _data.size() : 0;
+    if (firstNew == data.size() && firstNew > 0)
+        return firstNew;
+
+    // When appending, the buffers grow geometrically, so that not every batch copies all items
+    const bool reallocate = (firstNew == 0) || (data.size() > _capacity);
+    if (reallocate)
+        _capacity = (firstNew == 0) ? data.size() : std::max(data.size(), 2 * _capacity);
+    const size_t begin = reallocate ? 0 : firstNew;
+
+    // If the data is a view of a subset of the items, the values of the subset are gathered first
+    const Data batch = data.slice(begin, data.size() - begin);
+    AlignedBuffer gatheredValues;
+    for (size_t i = 0; i < _buffers.size(); ++i) {
+        const Data::Column column = batch.isContiguous() ? batch.getColumn(features[i]) :
+            batch.gatherColumn(features[i], gatheredValues);
+        glBindBuffer(GL_ARRAY_BUFFER, _buffers[i]);
+        if (reallocate)
+            glBufferData(GL_ARRAY_BUFFER, _capacity * column.valueSize, 0, GL_STATIC_DRAW);
+        if (column.size > 0)
+            glBufferSubData(GL_ARRAY_BUFFER, begin * column.valueSize, column.sizeInBytes(), column.data);
+        _features[i] = features[i];
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    _data = data;
+    return begin;
+}
+
+void ColumnBuffers::setAttribute(int i, GLuint location, GLuint divisor) const {
+    GLenum type;
+    GLboolean normalized;
+    float scale, offset;
+    attributeFormat(_data.getEncoding(), type, normalized, scale, offset);
+    glEnableVertexAttribArray(location);
+    glBindBuffer(GL_ARRAY_BUFFER, _buffers[i]);
+    glVertexAttribPointer(location, 1, type, normalized, 0, 0);
+    glVertexAttribDivisor(location, divisor);
+}
+
+void ColumnBuffers::attributeFormat(Data::Encoding encoding, GLenum& type, GLboolean& normalized, float& scale, float& offset) {
+    switch (encoding) {
+        case Data::ENCODING_FLOAT16:
+            type = GL_HALF_FLOAT;
+            normalized = GL_FALSE;
+            scale = 1.f;
+            offset = 0.f;
+            break;
+        case Data::ENCODING_FIXED16:
+            type = GL_UNSIGNED_SHORT;
+            normalized = GL_TRUE;
+            scale = 2.f;
+            offset = -1.f;
+            break;
+        case Data::ENCODING_FIXED8:
+            type = GL_UNSIGNED_BYTE;
+            normalized = GL_TRUE;
+            scale = 2.f;
+            offset = -1.f;
+            break;
+        default:
+            type = GL_FLOAT;
+            normalized = GL_FALSE;
+            scale = 1.f;
+            offset = 0.f;
+    }
+}
+
+} // namespace voreen
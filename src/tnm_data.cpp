@@ -0,0 +1,434 @@
+#include "modules/tnm093/include/tnm_data.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__F16C__)
+#include <immintrin.h>
+#endif
+
+namespace voreen {
+
+Data::Data(Encoding encoding, FeatureMask features)
+    : _encoding(encoding)
+    , _volumeDimensions(0)
+    , _blockSize(1)
+    , _features(features & FEATURES_ALL)
+    , _size(0)
+    , _indexStride(0)
+    , _firstRow(0)
+    , _rowStride(1)
+    , _hasRowList(false)
+{}
+
+size_t Data::getValueSize() const {
+    switch (_encoding) {
+        case ENCODING_FLOAT16:
+        case ENCODING_FIXED16:
+            return 2;
+        case ENCODING_FIXED8:
+            return 1;
+        default:
+            return sizeof(float);
+    }
+}
+
+const char* Data::encodingName(Encoding encoding) {
+    switch (encoding) {
+        case ENCODING_FLOAT16:
+            return "float16";
+        case ENCODING_FIXED16:
+            return "fixed16";
+        case ENCODING_FIXED8:
+            return "fixed8";
+        default:
+            return "float32";
+    }
+}
+
+void Data::addFeatures(FeatureMask features) {
+    materialize();
+    features &= FEATURES_ALL & ~_features;
+    _features |= features;
+    for (int k = 0; k < NUM_FEATURES; ++k) {
+        if (features & featureBit(k)) {
+            _columns[k] = CopyOnWrite<AlignedBuffer>();
+            _columns[k].edit().resize(_size * getValueSize());
+        }
+    }
+}
+
+void Data::resize(size_t size) {
+    materialize();
+    _size = size;
+    if (_indexStride == 0)
+        _voxelIndices.edit().resize(size);
+    for (int k = 0; k < NUM_FEATURES; ++k) {
+        if (hasFeature(k))
+            _columns[k].edit().resize(size * getValueSize());
+    }
+}
+
+void Data::reserve(size_t size) {
+    materialize();
+    if (_indexStride == 0)
+        _voxelIndices.edit().reserve(size);
+    for (int k = 0; k < NUM_FEATURES; ++k) {
+        if (hasFeature(k))
+            _columns[k].edit().reserve(size * getValueSize());
+    }
+}
+
+void Data::clear() {
+    _size = 0;
+    _firstRow = 0;
+    _rowStride = 1;
+    _hasRowList = false;
+    _rows = CopyOnWrite<std::vector<size_t> >();
+    _voxelIndices = CopyOnWrite<std::vector<VoxelIndex> >();
+    for (int k = 0; k < NUM_FEATURES; ++k)
+        _columns[k] = CopyOnWrite<AlignedBuffer>();
+}
+
+Data Data::slice(size_t begin, size_t count, size_t stride) const {
+    stride = std::max<size_t>(stride, 1);
+    Data view(*this);
+    view._size = count;
+    view._firstRow = _firstRow + begin * _rowStride;
+    view._rowStride = _rowStride * stride;
+    return view;
+}
+
+bool Data::extends(const Data& prefix) const {
+    if (prefix._size > _size || prefix._encoding != _encoding || prefix._features != _features ||
+        prefix._indexStride != _indexStride || prefix._blockSize != _blockSize)
+    {
+        return false;
+    }
+    // The first prefix.size() items are in the same rows if the selection is the same; the
+    // step between rows does not matter for a single item
+    if (prefix._firstRow != _firstRow || prefix._hasRowList != _hasRowList ||
+        (prefix._size > 1 && prefix._rowStride != _rowStride))
+    {
+        return false;
+    }
+    if (_hasRowList && !_rows.sharesWith(prefix._rows))
+        return false;
+    if (_indexStride == 0 && !_voxelIndices.sharesWith(prefix._voxelIndices))
+        return false;
+    for (int k = 0; k < NUM_FEATURES; ++k) {
+        if (hasFeature(k) && !_columns[k].sharesWith(prefix._columns[k]))
+            return false;
+    }
+    return true;
+}
+
+Data Data::select(const std::vector<size_t>& positions) const {
+    Data view(*this);
+    CopyOnWrite<std::vector<size_t> > rows;
+    std::vector<size_t>& rowList = rows.edit();
+    rowList.resize(positions.size());
+    for (size_t i = 0; i < positions.size(); ++i)
+        rowList[i] = row(positions[i]);
+    view._size = positions.size();
+    view._firstRow = 0;
+    view._rowStride = 1;
+    view._hasRowList = true;
+    view._rows = rows;
+    return view;
+}
+
+void Data::materialize() {
+    if (!isView())
+        return;
+
+    // A regular subsample of implicit indices starting at the first voxel stays implicit
+    if (_indexStride != 0 && !_hasRowList && _firstRow == 0) {
+        _indexStride *= _rowStride;
+        _voxelIndices = CopyOnWrite<std::vector<VoxelIndex> >();
+    }
+    else {
+        CopyOnWrite<std::vector<VoxelIndex> > voxelIndices;
+        std::vector<VoxelIndex>& indices = voxelIndices.edit();
+        indices.resize(_size);
+        for (size_t i = 0; i < _size; ++i)
+            indices[i] = getVoxelIndex(i);
+        _voxelIndices = voxelIndices;
+        _indexStride = 0;
+    }
+
+    for (int k = 0; k < NUM_FEATURES; ++k) {
+        if (!hasFeature(k))
+            continue;
+        CopyOnWrite<AlignedBuffer> column;
+        column.edit().resize(_size * getValueSize());
+        gatherValues(_columns[k].get().data(), column.edit().data());
+        _columns[k] = column;
+    }
+
+    _firstRow = 0;
+    _rowStride = 1;
+    _hasRowList = false;
+    _rows = CopyOnWrite<std::vector<size_t> >();
+}
+
+void Data::gatherValues(const unsigned char* column, unsigned char* destination) const {
+    switch (getValueSize()) {
+        case 1:
+            for (size_t i = 0; i < _size; ++i)
+                destination[i] = column[row(i)];
+            break;
+        case 2:
+            for (size_t i = 0; i < _size; ++i)
+                reinterpret_cast<uint16_t*>(destination)[i] = reinterpret_cast<const uint16_t*>(column)[row(i)];
+            break;
+        default:
+            for (size_t i = 0; i < _size; ++i)
+                reinterpret_cast<uint32_t*>(destination)[i] = reinterpret_cast<const uint32_t*>(column)[row(i)];
+    }
+}
+
+void Data::setVoxelIndex(size_t i, VoxelIndex voxelIndex) {
+    materialize();
+    if (_indexStride != 0) {
+        if (voxelIndex == static_cast<VoxelIndex>(i) * _indexStride)
+            return;
+        materializeVoxelIndices();
+    }
+    _voxelIndices.edit()[i] = voxelIndex;
+}
+
+void Data::setImplicitVoxelIndices(VoxelIndex stride) {
+    materialize();
+    _indexStride = std::max<VoxelIndex>(stride, 1);
+    _voxelIndices = CopyOnWrite<std::vector<VoxelIndex> >();
+}
+
+void Data::materializeVoxelIndices() {
+    std::vector<VoxelIndex>& indices = _voxelIndices.edit();
+    indices.resize(_size);
+    for (size_t i = 0; i < _size; ++i)
+        indices[i] = static_cast<VoxelIndex>(i) * _indexStride;
+    _indexStride = 0;
+}
+
+bool Data::isSortedByVoxelIndex() const {
+    if (_indexStride != 0 && !_hasRowList)
+        return true;
+    for (size_t i = 1; i < _size; ++i) {
+        if (getVoxelIndex(i) < getVoxelIndex(i - 1))
+            return false;
+    }
+    return true;
+}
+
+void Data::getMemberVoxels(VoxelIndex voxelIndex, std::vector<VoxelIndex>& members) const {
+    members.clear();
+    if (_blockSize <= 1 || _volumeDimensions.x <= 0 || _volumeDimensions.y <= 0 || _volumeDimensions.z <= 0) {
+        members.push_back(voxelIndex);
+        return;
+    }
+
+    const VoxelIndex planeSize = static_cast<VoxelIndex>(_volumeDimensions.x) * _volumeDimensions.y;
+    const int x = static_cast<int>(voxelIndex % _volumeDimensions.x);
+    const int y = static_cast<int>((voxelIndex / _volumeDimensions.x) % _volumeDimensions.y);
+    const int z = static_cast<int>(voxelIndex / planeSize);
+    const tgt::ivec3 first(x / _blockSize * _blockSize, y / _blockSize * _blockSize, z / _blockSize * _blockSize);
+    const tgt::ivec3 last(std::min(first.x + _blockSize, _volumeDimensions.x),
+        std::min(first.y + _blockSize, _volumeDimensions.y), std::min(first.z + _blockSize, _volumeDimensions.z));
+    for (int iZ = first.z; iZ < last.z; ++iZ) {
+        for (int iY = first.y; iY < last.y; ++iY) {
+            for (int iX = first.x; iX < last.x; ++iX)
+                members.push_back(iZ * planeSize + static_cast<VoxelIndex>(iY) * _volumeDimensions.x + iX);
+        }
+    }
+}
+
+VoxelIndex* Data::getVoxelIndices() {
+    materialize();
+    if (_indexStride != 0 || _size == 0)
+        return 0;
+    return &_voxelIndices.edit()[0];
+}
+
+const VoxelIndex* Data::getVoxelIndices() const {
+    if (isView() || _indexStride != 0 || _size == 0)
+        return 0;
+    return &_voxelIndices.get()[0];
+}
+
+unsigned char* Data::getColumnData(int feature) {
+    materialize();
+    if (!hasFeature(feature))
+        return 0;
+    return _columns[feature].edit().data();
+}
+
+const unsigned char* Data::getColumnData(int feature) const {
+    if (isView() || !hasFeature(feature))
+        return 0;
+    return _columns[feature].get().data();
+}
+
+Data::Column Data::getColumn(int feature) const {
+    Column column;
+    column.encoding = _encoding;
+    column.valueSize = getValueSize();
+    if (hasFeature(feature) && isContiguous()) {
+        column.data = _columns[feature].get().data() + _firstRow * column.valueSize;
+        column.size = _size;
+    }
+    return column;
+}
+
+Data::Column Data::gatherColumn(int feature, AlignedBuffer& buffer) const {
+    Column column;
+    column.encoding = _encoding;
+    column.valueSize = getValueSize();
+    if (hasFeature(feature)) {
+        buffer.resize(_size * column.valueSize);
+        gatherValues(_columns[feature].get().data(), buffer.data());
+        column.data = buffer.data();
+        column.size = _size;
+    }
+    return column;
+}
+
+void Data::setValue(size_t i, int feature, float value) {
+    setValues(feature, i, 1, &value);
+}
+
+void Data::getValues(int feature, size_t begin, size_t count, float* destination) const {
+    if (count == 0)
+        return;
+
+    if (!isContiguous()) {
+        for (size_t i = 0; i < count; ++i)
+            destination[i] = getValue(begin + i, feature);
+        return;
+    }
+
+    const unsigned char* column = _columns[feature].get().data() + _firstRow * getValueSize();
+    switch (_encoding) {
+        case ENCODING_FLOAT16: {
+            const uint16_t* values = reinterpret_cast<const uint16_t*>(column) + begin;
+            size_t i = 0;
+#if defined(__F16C__)
+            for (; i + 8 <= count; i += 8) {
+                const __m128i halfs = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i));
+                _mm256_storeu_ps(destination + i, _mm256_cvtph_ps(halfs));
+            }
+#endif
+            for (; i < count; ++i)
+                destination[i] = halfToFloat(values[i]);
+            break;
+        }
+        case ENCODING_FIXED16: {
+            const uint16_t* values = reinterpret_cast<const uint16_t*>(column) + begin;
+            for (size_t i = 0; i < count; ++i)
+                destination[i] = decodeFixed(values[i], 0xffff);
+            break;
+        }
+        case ENCODING_FIXED8: {
+            const uint8_t* values = column + begin;
+            for (size_t i = 0; i < count; ++i)
+                destination[i] = decodeFixed(values[i], 0xff);
+            break;
+        }
+        default:
+            std::memcpy(destination, reinterpret_cast<const float*>(column) + begin, count * sizeof(float));
+    }
+}
+
+void Data::setValues(int feature, size_t begin, size_t count, const float* source) {
+    if (count == 0)
+        return;
+
+    materialize();
+    unsigned char* column = _columns[feature].edit().data();
+    switch (_encoding) {
+        case ENCODING_FLOAT16: {
+            uint16_t* values = reinterpret_cast<uint16_t*>(column) + begin;
+            size_t i = 0;
+#if defined(__F16C__)
+            for (; i + 8 <= count; i += 8) {
+                const __m128i halfs = _mm256_cvtps_ph(_mm256_loadu_ps(source + i), _MM_FROUND_TO_NEAREST_INT);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(values + i), halfs);
+            }
+#endif
+            for (; i < count; ++i)
+                values[i] = floatToHalf(source[i]);
+            break;
+        }
+        case ENCODING_FIXED16: {
+            uint16_t* values = reinterpret_cast<uint16_t*>(column) + begin;
+            for (size_t i = 0; i < count; ++i)
+                values[i] = static_cast<uint16_t>(encodeFixed(source[i], 0xffff));
+            break;
+        }
+        case ENCODING_FIXED8: {
+            uint8_t* values = column + begin;
+            for (size_t i = 0; i < count; ++i)
+                values[i] = static_cast<uint8_t>(encodeFixed(source[i], 0xff));
+            break;
+        }
+        default:
+            std::memcpy(reinterpret_cast<float*>(column) + begin, source, count * sizeof(float));
+    }
+}
+
+const VoxelDataItem Data::operator[](size_t i) const {
+    VoxelDataItem item;
+    item.voxelIndex = getVoxelIndex(i);
+    for (int k = 0; k < NUM_FEATURES; ++k)
+        item.dataValues[k] = hasFeature(k) ? getValue(i, k) : 0.f;
+    return item;
+}
+
+const VoxelDataItem Data::at(size_t i) const {
+    if (i >= size())
+        throw std::out_of_range("Data::at");
+    return (*this)[i];
+}
+
+void Data::setItem(size_t i, const VoxelDataItem& item) {
+    setVoxelIndex(i, item.voxelIndex);
+    for (int k = 0; k < NUM_FEATURES; ++k) {
+        if (hasFeature(k))
+            setValue(i, k, item.dataValues[k]);
+    }
+}
+
+void Data::push_back(const VoxelDataItem& item) {
+    resize(size() + 1);
+    setItem(size() - 1, item);
+}
+
+void Data::append(const Data& other, size_t i) {
+    if (other._encoding != _encoding) {
+        push_back(other[i]);
+        return;
+    }
+
+    materialize();
+    const size_t valueSize = getValueSize();
+    const VoxelIndex voxelIndex = other.getVoxelIndex(i);
+    if (_indexStride != 0 && voxelIndex != static_cast<VoxelIndex>(_size) * _indexStride)
+        materializeVoxelIndices();
+    if (_indexStride == 0)
+        _voxelIndices.edit().push_back(voxelIndex);
+    ++_size;
+
+    const unsigned char zero[sizeof(float)] = { 0 };
+    for (int k = 0; k < NUM_FEATURES; ++k) {
+        if (!hasFeature(k))
+            continue;
+        if (other.hasFeature(k))
+            _columns[k].edit().append(other._columns[k].get().data() + other.row(i) * valueSize, valueSize);
+        else
+            _columns[k].edit().append(zero, valueSize);
+    }
+}
+
+} // namespace voreen
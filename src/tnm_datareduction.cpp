@@ -1,11 +1,209 @@
 #include "modules/tnm093/include/tnm_datareduction.h"
 
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <vector>
+
 namespace voreen {
 
+const std::string TNMDataReduction::loggerCat_("voreen.TNMDataReduction");
+
 namespace {
 	// We will sort the data using this function to ensure a strong ordering on the voxel indices
-	bool sortByIndex(const VoxelDataItem& lhs, const VoxelDataItem& rhs) {
-		return lhs.voxelIndex < rhs.voxelIndex;
+	class SortByIndex {
+	public:
+		SortByIndex(const Data& data) : _data(data) {}
+		bool operator()(size_t lhs, size_t rhs) const {
+			return _data.getVoxelIndex(lhs) < _data.getVoxelIndex(rhs);
+		}
+	private:
+		const Data& _data;
+	};
+
+	// The number of values that are decoded at once
+	const size_t DECODE_BLOCK_SIZE = 4096;
+
+	// The smallest importance weight, so that every item has a chance to be kept
+	const float MIN_IMPORTANCE = 1e-3f;
+
+	// The maximum number of cells of the grid for the stratified mode
+	const size_t MAX_STRATIFICATION_CELLS = 1 << 20;
+
+	// The factor by which the delivered prefix grows in every step of the progressive delivery
+	const size_t REFINEMENT_GROWTH = 4;
+
+	// A small, fast pseudo random number generator (xorshift64*). The sequence only depends on
+	// the seed, so the reduction is reproducible
+	class Random {
+	public:
+		explicit Random(uint64_t seed) : _state(seed != 0 ? seed : 1) {}
+
+		// Returns a uniformly distributed number in (0, 1]
+		double next() {
+			_state ^= _state >> 12;
+			_state ^= _state << 25;
+			_state ^= _state >> 27;
+			const uint64_t bits = (_state * 2685821657736338717ULL) >> 11;
+			return (bits + 1) * (1.0 / 9007199254740992.0);
+		}
+
+	private:
+		uint64_t _state;
+	};
+
+	// Turns the weights into the probabilities min(1, c * weight), with c chosen so that the
+	// probabilities sum up to targetCount. Items whose weight is large enough are kept for
+	// certain and the rest of the budget is shared by the others in proportion to their weight
+	void inclusionProbabilities(const std::vector<float>& weights, size_t targetCount, std::vector<float>& probabilities) {
+		const size_t numItems = weights.size();
+		probabilities.resize(numItems);
+		if (targetCount >= numItems) {
+			std::fill(probabilities.begin(), probabilities.end(), 1.f);
+			return;
+		}
+
+		// The set of capped items only grows from one iteration to the next, so this converges
+		// after a few passes
+		double scale = 0.0;
+		size_t numCapped = 0;
+		for (int iteration = 0; iteration < 64; ++iteration) {
+			size_t capped = 0;
+			double uncappedSum = 0.0;
+			for (size_t i = 0; i < numItems; ++i) {
+				if (scale * weights[i] >= 1.0)
+					++capped;
+				else
+					uncappedSum += weights[i];
+			}
+			if (uncappedSum <= 0.0 || capped >= targetCount)
+				break;
+			scale = (targetCount - capped) / uncappedSum;
+			if (iteration > 0 && capped == numCapped)
+				break;
+			numCapped = capped;
+		}
+
+		for (size_t i = 0; i < numItems; ++i)
+			probabilities[i] = static_cast<float>(std::min(1.0, scale * weights[i]));
+	}
+
+	// Keeps every item with its probability: the probabilities are accumulated in a running
+	// counter, and an item is kept whenever the counter passes one. This is the scheme of the
+	// uniform mode with varying probabilities; the kept positions are ascending
+	void systematicSample(const std::vector<float>& probabilities, std::vector<size_t>& positions) {
+		double counter = 0.5;
+		for (size_t i = 0; i < probabilities.size(); ++i) {
+			counter += probabilities[i];
+			if (counter >= 1.0) {
+				counter -= 1.0;
+				positions.push_back(i);
+			}
+		}
+	}
+
+	// The key of an item for weighted sampling without replacement (Efraimidis and Spirakis):
+	// the items with the 'count' largest keys log(u) / weight, for a random u, are a sample in
+	// which every item is drawn with a probability proportional to its weight
+	double samplingKey(Random& random, float weight) {
+		return std::log(random.next()) / weight;
+	}
+
+	typedef std::pair<double, size_t> KeyedItem;
+
+	// Draws 'count' items without replacement, each with a probability proportional to its
+	// weight, in a single pass; the reservoir holds the items with the largest keys
+	void weightedReservoir(const std::vector<float>& weights, size_t count, std::vector<size_t>& positions) {
+		std::priority_queue<KeyedItem, std::vector<KeyedItem>, std::greater<KeyedItem> > reservoir;
+		Random random(weights.size());
+		for (size_t i = 0; i < weights.size(); ++i) {
+			const double key = samplingKey(random, weights[i]);
+			if (reservoir.size() < count)
+				reservoir.push(KeyedItem(key, i));
+			else if (key > reservoir.top().first) {
+				reservoir.pop();
+				reservoir.push(KeyedItem(key, i));
+			}
+		}
+
+		positions.reserve(reservoir.size());
+		while (!reservoir.empty()) {
+			positions.push_back(reservoir.top().second);
+			reservoir.pop();
+		}
+		std::sort(positions.begin(), positions.end());
+	}
+
+	// The orders below are nested samples: every prefix of the order is a sample of the
+	// respective mode, so a reduction to any size is a prefix
+
+	// The positions 0, ..., numItems - 1 in bit-reversed order (a van der Corput sequence), so
+	// every prefix is spread evenly over all items, like the uniform mode
+	void bitReversedOrder(size_t numItems, std::vector<size_t>& order) {
+		int numBits = 0;
+		while ((static_cast<uint64_t>(1) << numBits) < numItems)
+			++numBits;
+
+		order.reserve(numItems);
+		for (uint64_t r = 0; r < (static_cast<uint64_t>(1) << numBits); ++r) {
+			uint64_t position = 0;
+			for (int bit = 0; bit < numBits; ++bit)
+				position |= ((r >> bit) & 1) << (numBits - 1 - bit);
+			if (position < numItems)
+				order.push_back(static_cast<size_t>(position));
+		}
+	}
+
+	// The items in the order of decreasing sampling keys, so every prefix is a weighted sample
+	// without replacement
+	void importanceOrder(const std::vector<float>& weights, std::vector<size_t>& order) {
+		std::vector<KeyedItem> keyedItems(weights.size());
+		Random random(weights.size());
+		for (size_t i = 0; i < weights.size(); ++i)
+			keyedItems[i] = KeyedItem(samplingKey(random, weights[i]), i);
+		std::sort(keyedItems.begin(), keyedItems.end(), std::greater<KeyedItem>());
+
+		order.resize(keyedItems.size());
+		for (size_t i = 0; i < keyedItems.size(); ++i)
+			order[i] = keyedItems[i].second;
+	}
+
+	// The items of all cells in turns: first one random item of every cell, then a second one
+	// of every cell that has one, and so on. Every prefix thus contains the same number of items
+	// of every cell, or all items of the cells that have fewer, like the stratified mode
+	void stratifiedOrder(const std::vector<uint32_t>& cells, size_t numCells, std::vector<size_t>& order) {
+		const size_t numItems = cells.size();
+
+		// Shuffle the items (Fisher-Yates), so the items of a cell are taken in random order
+		std::vector<size_t> shuffled(numItems);
+		for (size_t i = 0; i < numItems; ++i)
+			shuffled[i] = i;
+		Random random(numItems);
+		for (size_t i = numItems; i > 1; --i) {
+			const size_t j = std::min(i - 1, static_cast<size_t>(random.next() * i));
+			std::swap(shuffled[i - 1], shuffled[j]);
+		}
+
+		// The turn in which every item is taken is the number of items of its cell before it
+		std::vector<uint32_t> taken(numCells, 0);
+		std::vector<uint32_t> turns(numItems);
+		uint32_t numTurns = 0;
+		for (size_t i = 0; i < numItems; ++i) {
+			turns[i] = taken[cells[shuffled[i]]]++;
+			numTurns = std::max(numTurns, turns[i] + 1);
+		}
+
+		// Sort by turn with a counting sort, which keeps the random order within every turn
+		std::vector<size_t> turnStart(numTurns + 1, 0);
+		for (size_t i = 0; i < numItems; ++i)
+			++turnStart[turns[i] + 1];
+		for (uint32_t t = 0; t < numTurns; ++t)
+			turnStart[t + 1] += turnStart[t];
+		order.resize(numItems);
+		for (size_t i = 0; i < numItems; ++i)
+			order[turnStart[turns[i]]++] = shuffled[i];
 	}
 
 }
@@ -14,16 +212,292 @@ TNMDataReduction::TNMDataReduction()
     : _inport(Port::INPORT, "in.data")
     , _outport(Port::OUTPORT, "out.data")
     , _percentage("percentage", "Percentage of Dropped Data")
+    , _mode("reductionMode", "Reduction Mode")
+    , _importanceFeature("importanceFeature", "Importance Feature")
+    , _importanceExponent("importanceExponent", "Importance Exponent", 1.f, 0.f, 4.f)
+    , _numBins("numBins", "Bins per Feature (Stratified)", 8, 2, 32)
+    , _sampleCount("sampleCount", "Number of Items (Reservoir)", 100000, 1, 100000000)
+    , _superVoxelSize("superVoxelSize", "Super-Voxel Size", 2, 2, 16)
+    , _aggregation("aggregation", "Super-Voxel Aggregation")
+    , _levelOfDetail("levelOfDetail", "Precomputed Level of Detail", true)
+    , _progressive("progressive", "Progressive Delivery", false)
+    , _initialBatchSize("initialBatchSize", "Initial Batch Size (Progressive)", 16384, 256, 1 << 24)
+    , _levelOfDetailValid(false)
+    , _deliveredCount(0)
+    , _refinementTimer(this)
 {
     addPort(_inport);
     addPort(_outport);
     addProperty(_percentage);
+    addProperty(_mode);
+    addProperty(_importanceFeature);
+    addProperty(_importanceExponent);
+    addProperty(_numBins);
+    addProperty(_sampleCount);
+    addProperty(_superVoxelSize);
+    addProperty(_aggregation);
+    addProperty(_levelOfDetail);
+    addProperty(_progressive);
+    addProperty(_initialBatchSize);
+
+    _mode.addOption("uniform", "Uniform", REDUCTION_UNIFORM);
+    _mode.addOption("stratified", "Stratified (Feature-Space Bins)", REDUCTION_STRATIFIED);
+    _mode.addOption("importance", "Importance-Weighted", REDUCTION_IMPORTANCE);
+    _mode.addOption("reservoir", "Weighted Reservoir", REDUCTION_RESERVOIR);
+    _mode.addOption("supervoxel", "Super-Voxels", REDUCTION_SUPERVOXEL);
+
+    _aggregation.addOption("mean", "Mean", AGGREGATION_MEAN);
+    _aggregation.addOption("minimum", "Minimum", AGGREGATION_MINIMUM);
+    _aggregation.addOption("maximum", "Maximum", AGGREGATION_MAXIMUM);
+    _aggregation.addOption("representative", "Representative", AGGREGATION_REPRESENTATIVE);
+
+    for (int i = 0; i < NUM_FEATURES; ++i)
+        _importanceFeature.addOption(featureDescriptor(i).identifier, featureDescriptor(i).name, i);
+    _importanceFeature.selectByValue(FEATURE_GRADIENT_MAGNITUDE);
+
+    _mode.onChange(CallMemberAction<TNMDataReduction>(this, &TNMDataReduction::requestFeatures));
+    _importanceFeature.onChange(CallMemberAction<TNMDataReduction>(this, &TNMDataReduction::requestFeatures));
+    _importanceExponent.onChange(CallMemberAction<TNMDataReduction>(this, &TNMDataReduction::invalidateLevelOfDetail));
+    _numBins.onChange(CallMemberAction<TNMDataReduction>(this, &TNMDataReduction::invalidateLevelOfDetail));
 }
 
 Processor* TNMDataReduction::create() const {
     return new TNMDataReduction;
 }
 
+FeatureMask TNMDataReduction::getRequiredFeatures() const {
+    FeatureMask features = collectRequiredFeatures(&_outport);
+    if (_mode.getValue() == REDUCTION_IMPORTANCE || _mode.getValue() == REDUCTION_RESERVOIR)
+        features |= featureBit(_importanceFeature.getValue());
+    return features;
+}
+
+void TNMDataReduction::requestFeatures() {
+    invalidateLevelOfDetail();
+    invalidateFeatureSources(&_inport);
+}
+
+void TNMDataReduction::importanceWeights(const Data& data, std::vector<float>& weights) const {
+    const int feature = _importanceFeature.getValue();
+    const float exponent = _importanceExponent.get();
+    weights.resize(data.size());
+    if (data.empty())
+        return;
+    if (!data.hasFeature(feature)) {
+        LWARNING(featureDescriptor(feature).name << " has not been extracted; all items are equally important");
+        std::fill(weights.begin(), weights.end(), 1.f);
+        return;
+    }
+
+    // The values are normalized to [-1,1], so the importance is the value mapped to [0,1]
+    data.getValues(feature, 0, data.size(), &weights[0]);
+    for (size_t i = 0; i < weights.size(); ++i) {
+        const float importance = std::max(0.f, std::min(1.f, (weights[i] + 1.f) * 0.5f));
+        weights[i] = std::pow(importance, exponent) + MIN_IMPORTANCE;
+    }
+}
+
+size_t TNMDataReduction::stratificationCells(const Data& data, std::vector<uint32_t>& cells) const {
+    // The grid spans the features that the connected processors show, so every combination of
+    // values they can display keeps some of its items. The number of bins per feature is
+    // reduced if the grid would get too large
+    std::vector<int> features;
+    const FeatureMask shownFeatures = collectRequiredFeatures(&_outport) & data.getFeatures();
+    for (int k = 0; k < NUM_FEATURES; ++k) {
+        if (shownFeatures & featureBit(k))
+            features.push_back(k);
+    }
+    int numBins = _numBins.get();
+    size_t numCells = 1;
+    for (; numBins > 1; --numBins) {
+        numCells = 1;
+        for (size_t k = 0; k < features.size(); ++k)
+            numCells *= numBins;
+        if (numCells <= MAX_STRATIFICATION_CELLS)
+            break;
+    }
+
+    // The cell of every item; the values are normalized to [-1,1]
+    const size_t numItems = data.size();
+    cells.assign(numItems, 0);
+    std::vector<float> values(DECODE_BLOCK_SIZE);
+    for (size_t k = 0; k < features.size(); ++k) {
+        for (size_t begin = 0; begin < numItems; begin += DECODE_BLOCK_SIZE) {
+            const size_t count = std::min(DECODE_BLOCK_SIZE, numItems - begin);
+            data.getValues(features[k], begin, count, &values[0]);
+            for (size_t i = 0; i < count; ++i) {
+                const int bin = std::max(0, std::min(numBins - 1, static_cast<int>((values[i] + 1.f) * 0.5f * numBins)));
+                cells[begin + i] = cells[begin + i] * numBins + bin;
+            }
+        }
+    }
+    return numCells;
+}
+
+void TNMDataReduction::stratifiedProbabilities(const Data& data, size_t targetCount,
+                                               std::vector<float>& probabilities) const
+{
+    std::vector<uint32_t> cells;
+    const size_t numCells = stratificationCells(data, cells);
+
+    // Every cell gets the same share of the items; cells with fewer items than their share
+    // keep all of them, and the remaining budget goes to the other cells. Weighting every item
+    // with one over the population of its cell does exactly that
+    std::vector<uint32_t> population(numCells, 0);
+    for (size_t i = 0; i < cells.size(); ++i)
+        ++population[cells[i]];
+    std::vector<float> weights(cells.size());
+    for (size_t i = 0; i < cells.size(); ++i)
+        weights[i] = 1.f / population[cells[i]];
+    inclusionProbabilities(weights, targetCount, probabilities);
+}
+
+void TNMDataReduction::buildLevelOfDetail(const Data& data) {
+    std::vector<size_t> order;
+    switch (_mode.getValue()) {
+        case REDUCTION_STRATIFIED: {
+            std::vector<uint32_t> cells;
+            const size_t numCells = stratificationCells(data, cells);
+            stratifiedOrder(cells, numCells, order);
+            break;
+        }
+        case REDUCTION_IMPORTANCE:
+        case REDUCTION_RESERVOIR: {
+            std::vector<float> weights;
+            importanceWeights(data, weights);
+            importanceOrder(weights, order);
+            break;
+        }
+        default:
+            bitReversedOrder(data.size(), order);
+    }
+    _levelOfDetailOrder = data.select(order);
+    _levelOfDetailValid = true;
+    _deliveredCount = 0;
+}
+
+void TNMDataReduction::invalidateLevelOfDetail() {
+    _levelOfDetailValid = false;
+}
+
+Data* TNMDataReduction::aggregateSuperVoxels(const Data& data) const {
+    if (data.empty())
+        return new Data(data);
+
+    // If the input consists of super-voxels already, the new blocks consist of k x k x k of them
+    const int blockSize = _superVoxelSize.get() * data.getBlockSize();
+    const Aggregation aggregation = static_cast<Aggregation>(_aggregation.getValue());
+    const tgt::ivec3& dimensions = data.getVolumeDimensions();
+    const size_t planeSize = static_cast<size_t>(dimensions.x) * dimensions.y;
+    const tgt::ivec3 numBlocks((dimensions.x + blockSize - 1) / blockSize,
+        (dimensions.y + blockSize - 1) / blockSize, (dimensions.z + blockSize - 1) / blockSize);
+    const size_t totalBlocks = static_cast<size_t>(numBlocks.x) * numBlocks.y * numBlocks.z;
+    const size_t numItems = data.size();
+
+    // The block of every item, and the position of every non-empty block in the result
+    std::vector<size_t> blockOfItem(numItems);
+    std::vector<uint32_t> population(totalBlocks, 0);
+    for (size_t i = 0; i < numItems; ++i) {
+        const VoxelIndex voxelIndex = data.getVoxelIndex(i);
+        const int x = static_cast<int>(voxelIndex % dimensions.x);
+        const int y = static_cast<int>((voxelIndex / dimensions.x) % dimensions.y);
+        const int z = static_cast<int>(voxelIndex / planeSize);
+        blockOfItem[i] = (static_cast<size_t>(z / blockSize) * numBlocks.y + y / blockSize) * numBlocks.x + x / blockSize;
+        ++population[blockOfItem[i]];
+    }
+    const size_t noBlock = static_cast<size_t>(-1);
+    std::vector<size_t> resultPosition(totalBlocks, noBlock);
+    size_t numResults = 0;
+    for (size_t b = 0; b < totalBlocks; ++b) {
+        if (population[b] > 0)
+            resultPosition[b] = numResults++;
+    }
+
+    Data* result = new Data(data.getEncoding(), data.getFeatures());
+    result->resize(numResults);
+    result->setVolumeDimensions(dimensions);
+    result->setBlockSize(blockSize);
+
+    // Every item carries the index of the first voxel of its block
+    for (size_t b = 0; b < totalBlocks; ++b) {
+        if (resultPosition[b] == noBlock)
+            continue;
+        const size_t bX = b % numBlocks.x;
+        const size_t bY = (b / numBlocks.x) % numBlocks.y;
+        const size_t bZ = b / (static_cast<size_t>(numBlocks.x) * numBlocks.y);
+        result->setVoxelIndex(resultPosition[b], static_cast<VoxelIndex>(bZ * blockSize) * planeSize +
+            bY * blockSize * dimensions.x + bX * blockSize);
+    }
+
+    // The mean, minimum, or maximum of every feature; the representative needs the means
+    std::vector<float> values(DECODE_BLOCK_SIZE);
+    std::vector<float> aggregated(numResults);
+    std::vector<double> sums(numResults);
+    std::vector<float> distances(aggregation == AGGREGATION_REPRESENTATIVE ? numItems : 0, 0.f);
+    for (int k = 0; k < NUM_FEATURES; ++k) {
+        if (!data.hasFeature(k))
+            continue;
+
+        std::fill(sums.begin(), sums.end(), 0.0);
+        if (aggregation == AGGREGATION_MINIMUM)
+            std::fill(aggregated.begin(), aggregated.end(), std::numeric_limits<float>::max());
+        else if (aggregation == AGGREGATION_MAXIMUM)
+            std::fill(aggregated.begin(), aggregated.end(), -std::numeric_limits<float>::max());
+        for (size_t begin = 0; begin < numItems; begin += DECODE_BLOCK_SIZE) {
+            const size_t count = std::min(DECODE_BLOCK_SIZE, numItems - begin);
+            data.getValues(k, begin, count, &values[0]);
+            for (size_t i = 0; i < count; ++i) {
+                const size_t position = resultPosition[blockOfItem[begin + i]];
+                if (aggregation == AGGREGATION_MINIMUM)
+                    aggregated[position] = std::min(aggregated[position], values[i]);
+                else if (aggregation == AGGREGATION_MAXIMUM)
+                    aggregated[position] = std::max(aggregated[position], values[i]);
+                else
+                    sums[position] += values[i];
+            }
+        }
+        if (aggregation == AGGREGATION_MEAN || aggregation == AGGREGATION_REPRESENTATIVE) {
+            for (size_t b = 0; b < totalBlocks; ++b) {
+                if (resultPosition[b] != noBlock)
+                    aggregated[resultPosition[b]] = static_cast<float>(sums[resultPosition[b]] / population[b]);
+            }
+        }
+
+        if (aggregation != AGGREGATION_REPRESENTATIVE) {
+            result->setValues(k, 0, numResults, &aggregated[0]);
+            continue;
+        }
+
+        // Accumulate the squared distance of every item to the mean of its block
+        for (size_t begin = 0; begin < numItems; begin += DECODE_BLOCK_SIZE) {
+            const size_t count = std::min(DECODE_BLOCK_SIZE, numItems - begin);
+            data.getValues(k, begin, count, &values[0]);
+            for (size_t i = 0; i < count; ++i) {
+                const float difference = values[i] - aggregated[resultPosition[blockOfItem[begin + i]]];
+                distances[begin + i] += difference * difference;
+            }
+        }
+    }
+
+    // The representative of a block is the item closest to the mean; it is passed on unchanged
+    if (aggregation == AGGREGATION_REPRESENTATIVE) {
+        std::vector<size_t> representative(numResults, noBlock);
+        for (size_t i = 0; i < numItems; ++i) {
+            size_t& best = representative[resultPosition[blockOfItem[i]]];
+            if (best == noBlock || distances[i] < distances[best])
+                best = i;
+        }
+        for (size_t j = 0; j < numResults; ++j) {
+            result->setVoxelIndex(j, data.getVoxelIndex(representative[j]));
+            for (int k = 0; k < NUM_FEATURES; ++k) {
+                if (data.hasFeature(k))
+                    result->setValue(j, k, data.getValue(representative[j], k));
+            }
+        }
+    }
+    return result;
+}
+
 void TNMDataReduction::process() {
     if (!_inport.hasData())
         return;
@@ -31,26 +505,102 @@ void TNMDataReduction::process() {
     // We have checked above that there is data, so the dereferencing is safe
     const Data& inportData = *(_inport.getData());
     const float percentage = _percentage.get();
-    
-    // Our new data
-    Data* outportData = new Data;
-    
-    
-    LINFOC("Picking", "Filtering out " << percentage*100 << "% of " << inportData.size());
-    
-    float counter = (1.0f - percentage);
-    
-    for (size_t i = 0; i < inportData.size(); i++) {
-      if (counter > 1.0f) {
-	counter -= 1.0f;
-	const VoxelDataItem& item = inportData[i];
-	outportData->push_back(item);
-      }
-      counter += (1.0f - percentage);
-    }
-
-    // sort the data by the voxel index for faster processing later
-    std::sort(outportData->begin(), outportData->end(), sortByIndex);
+    const size_t targetCount = static_cast<size_t>(inportData.size() * (1.0 - percentage) + 0.5);
+
+    // With the level of detail, the order of the items is computed once per input and every
+    // reduction is a prefix of it. The output is in that order, from the most to the least
+    // important item, and not sorted by the voxel index
+    if (_levelOfDetail.get() && _mode.getValue() != REDUCTION_SUPERVOXEL) {
+        if (!_levelOfDetailValid || _inport.hasChanged())
+            buildLevelOfDetail(inportData);
+        const size_t count = std::min(inportData.size(), (_mode.getValue() == REDUCTION_RESERVOIR) ?
+            static_cast<size_t>(_sampleCount.get()) : targetCount);
+
+        // With the progressive delivery, a small prefix is published first and grows in the
+        // following frames until it has reached 'count'. Every step extends the previous one,
+        // so the renderers only have to upload the new items (see Data::extends())
+        size_t delivered = count;
+        if (_progressive.get() && count > _deliveredCount) {
+            delivered = std::min(count, std::max(static_cast<size_t>(_initialBatchSize.get()),
+                _deliveredCount * REFINEMENT_GROWTH));
+            if (delivered < count && !_refinementTimer.schedule())
+                delivered = count;
+        }
+        _deliveredCount = delivered;
+
+        if (delivered < count)
+            LINFO("Keeping " << delivered << " of " << count << " of " << inportData.size() << " items so far");
+        else
+            LINFO("Keeping " << count << " of " << inportData.size() << " items");
+        _outport.setData(new Data(_levelOfDetailOrder.slice(0, delivered)));
+        return;
+    }
+    _refinementTimer.cancel();
+    // The order is not needed anymore; this releases its reference to the input
+    _levelOfDetailOrder = Data();
+    _levelOfDetailValid = false;
+
+    if (_mode.getValue() == REDUCTION_SUPERVOXEL) {
+        const tgt::ivec3& dimensions = inportData.getVolumeDimensions();
+        if (dimensions.x <= 0 || dimensions.y <= 0 || dimensions.z <= 0) {
+            LWARNING("The volume dimensions of the input are unknown, so no super-voxels can be formed");
+            _outport.setData(new Data(inportData));
+            return;
+        }
+        Data* outportData = aggregateSuperVoxels(inportData);
+        LINFO("Aggregated " << inportData.size() << " items into " << outportData->size() << " super-voxels");
+        _outport.setData(outportData);
+        return;
+    }
+
+    // The positions of the items that are kept
+    std::vector<size_t> kept;
+    switch (_mode.getValue()) {
+        case REDUCTION_STRATIFIED: {
+            std::vector<float> probabilities;
+            stratifiedProbabilities(inportData, targetCount, probabilities);
+            systematicSample(probabilities, kept);
+            break;
+        }
+        case REDUCTION_IMPORTANCE: {
+            std::vector<float> weights;
+            std::vector<float> probabilities;
+            importanceWeights(inportData, weights);
+            inclusionProbabilities(weights, targetCount, probabilities);
+            systematicSample(probabilities, kept);
+            break;
+        }
+        case REDUCTION_RESERVOIR: {
+            std::vector<float> weights;
+            importanceWeights(inportData, weights);
+            weightedReservoir(weights, static_cast<size_t>(_sampleCount.get()), kept);
+            break;
+        }
+        default: {
+            float counter = (1.0f - percentage);
+            kept.reserve(targetCount + 1);
+            for (size_t i = 0; i < inportData.size(); i++) {
+              if (counter > 1.0f) {
+                counter -= 1.0f;
+                kept.push_back(i);
+              }
+              counter += (1.0f - percentage);
+            }
+        }
+    }
+
+    LINFO("Keeping " << kept.size() << " of " << inportData.size() << " items");
+
+    // sort the data by the voxel index for faster processing later. The positions are
+    // ascending, so this is only necessary if the input is not sorted already
+    if (!inportData.isSortedByVoxelIndex())
+      std::sort(kept.begin(), kept.end(), SortByIndex(inportData));
+
+    // Our new data is a view of the kept items that shares the values with the input, so
+    // nothing but the positions is copied. The values stay alive as long as the view refers
+    // to them, even if the source replaces its data
+    Data* outportData = new Data(inportData.select(kept));
+
     // Place the new data into the outport (and transferring ownership at the same time)
     _outport.setData(outportData);
 }
@@ -0,0 +1,286 @@
+#include "modules/tnm093/include/tnm_featurecache.h"
+
+#include "tgt/logmanager.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace voreen {
+
+const std::string FeatureCache::loggerCat_("voreen.TNMFeatureCache");
+
+namespace {
+    // The version of the cache files; has to be increased whenever the extraction changes
+    // in a way that produces different values
+    const uint32_t CACHE_FORMAT_VERSION = 6;
+
+    // The magic number at the beginning of each cache file
+    const char CACHE_MAGIC[8] = { 'T', 'N', 'M', 'F', 'E', 'A', 'T', '\0' };
+
+    // The name of the index file in the cache directory
+    const std::string INDEX_FILE_NAME = "tnm093_featurecache.index";
+
+    // The number of bytes that are hashed independently before the chunk hashes are combined
+    const size_t HASH_CHUNK_SIZE = 1 << 20;
+
+    const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ULL;
+    const uint64_t FNV_PRIME = 1099511628211ULL;
+
+    uint64_t fnv1a(const unsigned char* data, size_t numBytes, uint64_t hash) {
+        for (size_t i = 0; i < numBytes; ++i) {
+            hash ^= data[i];
+            hash *= FNV_PRIME;
+        }
+        return hash;
+    }
+
+    // The header at the beginning of each cache file. It is followed by the voxel indices (unless
+    // they are implicit) and then, for every feature in 'features' in ascending order, the encoded values
+    struct CacheFileHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t encoding; // The Data::Encoding of the values
+        uint32_t valueSize; // The number of bytes per value
+        int32_t dimensions[3];
+        int32_t radius;
+        char voxelType[8];
+        uint32_t features; // The FeatureMask of the features that are stored
+        uint32_t padding;
+        uint64_t contentHash;
+        uint64_t numItems;
+        uint64_t indexStride; // The stride of implicit voxel indices, or 0 if the indices are stored
+    };
+}
+
+FeatureCache::Key::Key()
+    : dimensions(0)
+    , radius(0)
+    , encoding(Data::ENCODING_FLOAT32)
+    , contentHash(0)
+{}
+
+FeatureCache::Key::Key(const tgt::ivec3& dimensions, const std::string& voxelType, int radius,
+                       Data::Encoding encoding, uint64_t contentHash)
+    : dimensions(dimensions)
+    , voxelType(voxelType)
+    , radius(radius)
+    , encoding(encoding)
+    , contentHash(contentHash)
+{}
+
+std::string FeatureCache::Key::fileName() const {
+    std::ostringstream s;
+    s << "features_" << std::hex << contentHash << std::dec << "_"
+      << dimensions.x << "x" << dimensions.y << "x" << dimensions.z << "_" << voxelType
+      << "_r" << radius << "_" << Data::encodingName(encoding) << ".tnmcache";
+    return s.str();
+}
+
+FeatureCache::FeatureCache()
+    : _sizeLimit(0)
+{}
+
+void FeatureCache::setDirectory(const std::string& directory) {
+    _directory = directory;
+}
+
+void FeatureCache::setSizeLimit(uint64_t sizeLimit) {
+    _sizeLimit = sizeLimit;
+}
+
+std::string FeatureCache::path(const std::string& fileName) const {
+    if (_directory.empty())
+        return fileName;
+    return _directory + "/" + fileName;
+}
+
+bool FeatureCache::load(const Key& key, Data& data, FeatureMask& features) {
+    const std::string fileName = key.fileName();
+    std::ifstream file(path(fileName).c_str(), std::ios::binary);
+    if (!file)
+        return false;
+
+    data = Data(key.encoding, 0);
+    CacheFileHeader header;
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!file || std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 ||
+        header.version != CACHE_FORMAT_VERSION || header.encoding != static_cast<uint32_t>(key.encoding) ||
+        header.valueSize != data.getValueSize() ||
+        header.dimensions[0] != key.dimensions.x || header.dimensions[1] != key.dimensions.y ||
+        header.dimensions[2] != key.dimensions.z || header.radius != key.radius ||
+        std::strncmp(header.voxelType, key.voxelType.c_str(), sizeof(header.voxelType)) != 0 ||
+        header.contentHash != key.contentHash || (header.features & ~FEATURES_ALL) != 0)
+    {
+        LWARNING("Ignoring invalid or outdated cache file " << fileName);
+        return false;
+    }
+
+    const size_t numItems = static_cast<size_t>(header.numItems);
+    data.addFeatures(header.features);
+    data.setVolumeDimensions(key.dimensions);
+    if (header.indexStride != 0)
+        data.setImplicitVoxelIndices(header.indexStride);
+    data.resize(numItems);
+    if (numItems > 0) {
+        if (data.hasVoxelIndices())
+            file.read(reinterpret_cast<char*>(data.getVoxelIndices()), numItems * sizeof(VoxelIndex));
+        for (int k = 0; k < NUM_FEATURES; ++k) {
+            if (header.features & featureBit(k))
+                file.read(reinterpret_cast<char*>(data.getColumnData(k)), numItems * data.getValueSize());
+        }
+    }
+    if (!file) {
+        LWARNING("Cache file " << fileName << " is truncated");
+        data.clear();
+        return false;
+    }
+    features = header.features;
+
+    std::vector<Entry> entries = readIndex();
+    touch(entries, fileName, fileSize(data, features));
+    writeIndex(entries);
+    return true;
+}
+
+bool FeatureCache::store(const Key& key, const Data& data, FeatureMask features) {
+    // The arrays of a view contain items that are not part of it, so it is copied first
+    if (data.isView()) {
+        Data items(data);
+        items.materialize();
+        return store(key, items, features);
+    }
+
+    const std::string fileName = key.fileName();
+    features &= data.getFeatures();
+    const uint64_t size = fileSize(data, features);
+    if (_sizeLimit > 0 && size > _sizeLimit) {
+        LINFO("Not caching " << fileName << ", it is larger than the cache size limit");
+        return false;
+    }
+
+    // Evict the least recently used entries until the new entry fits
+    std::vector<Entry> entries = readIndex();
+    uint64_t totalSize = 0;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        if (entries[i].fileName != fileName)
+            totalSize += entries[i].size;
+    }
+    while (_sizeLimit > 0 && totalSize + size > _sizeLimit && !entries.empty()) {
+        size_t oldest = 0;
+        for (size_t i = 1; i < entries.size(); ++i) {
+            if (entries[i].lastUse < entries[oldest].lastUse)
+                oldest = i;
+        }
+        if (entries[oldest].fileName != fileName) {
+            LINFO("Evicting " << entries[oldest].fileName << " from the feature cache");
+            std::remove(path(entries[oldest].fileName).c_str());
+            totalSize -= entries[oldest].size;
+        }
+        entries.erase(entries.begin() + oldest);
+    }
+
+    CacheFileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = CACHE_FORMAT_VERSION;
+    header.encoding = data.getEncoding();
+    header.valueSize = static_cast<uint32_t>(data.getValueSize());
+    header.dimensions[0] = key.dimensions.x;
+    header.dimensions[1] = key.dimensions.y;
+    header.dimensions[2] = key.dimensions.z;
+    header.radius = key.radius;
+    std::strncpy(header.voxelType, key.voxelType.c_str(), sizeof(header.voxelType) - 1);
+    header.features = features;
+    header.contentHash = key.contentHash;
+    header.numItems = data.size();
+    header.indexStride = data.getVoxelIndexStride();
+
+    std::ofstream file(path(fileName).c_str(), std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    if (!data.empty()) {
+        if (data.hasVoxelIndices())
+            file.write(reinterpret_cast<const char*>(data.getVoxelIndices()), data.size() * sizeof(VoxelIndex));
+        for (int k = 0; k < NUM_FEATURES; ++k) {
+            if (features & featureBit(k))
+                file.write(reinterpret_cast<const char*>(data.getColumnData(k)), data.size() * data.getValueSize());
+        }
+    }
+    file.close();
+    if (!file) {
+        LWARNING("Could not write cache file " << path(fileName));
+        std::remove(path(fileName).c_str());
+        writeIndex(entries);
+        return false;
+    }
+
+    touch(entries, fileName, size);
+    writeIndex(entries);
+    return true;
+}
+
+uint64_t FeatureCache::fileSize(const Data& data, FeatureMask features) {
+    const uint64_t indexSize = data.hasVoxelIndices() ? sizeof(VoxelIndex) : 0;
+    return sizeof(CacheFileHeader) + data.size() * (indexSize + featureCount(features) * data.getValueSize());
+}
+
+uint64_t FeatureCache::hashContent(const void* data, size_t numBytes) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    const int numChunks = static_cast<int>((numBytes + HASH_CHUNK_SIZE - 1) / HASH_CHUNK_SIZE);
+    std::vector<uint64_t> chunkHashes(numChunks);
+
+#ifdef _OPENMP
+    #pragma omp parallel for
+#endif
+    for (int i = 0; i < numChunks; ++i) {
+        const size_t begin = i * HASH_CHUNK_SIZE;
+        const size_t size = std::min(HASH_CHUNK_SIZE, numBytes - begin);
+        chunkHashes[i] = fnv1a(bytes + begin, size, FNV_OFFSET_BASIS);
+    }
+
+    // Combine the chunk hashes (and the total size) in a fixed order
+    uint64_t hash = fnv1a(reinterpret_cast<const unsigned char*>(&numBytes), sizeof(numBytes), FNV_OFFSET_BASIS);
+    if (numChunks > 0)
+        hash = fnv1a(reinterpret_cast<const unsigned char*>(&chunkHashes[0]), numChunks * sizeof(uint64_t), hash);
+    return hash;
+}
+
+std::vector<FeatureCache::Entry> FeatureCache::readIndex() const {
+    std::vector<Entry> entries;
+    std::ifstream index(path(INDEX_FILE_NAME).c_str());
+    Entry entry;
+    while (index >> entry.fileName >> entry.size >> entry.lastUse)
+        entries.push_back(entry);
+    return entries;
+}
+
+void FeatureCache::writeIndex(const std::vector<Entry>& entries) const {
+    std::ofstream index(path(INDEX_FILE_NAME).c_str(), std::ios::trunc);
+    for (size_t i = 0; i < entries.size(); ++i)
+        index << entries[i].fileName << " " << entries[i].size << " " << entries[i].lastUse << std::endl;
+    if (!index)
+        LWARNING("Could not write the feature cache index in " << _directory);
+}
+
+void FeatureCache::touch(std::vector<Entry>& entries, const std::string& fileName, uint64_t size) const {
+    uint64_t lastUse = 0;
+    std::vector<Entry>::iterator existing = entries.end();
+    for (std::vector<Entry>::iterator it = entries.begin(); it != entries.end(); ++it) {
+        lastUse = std::max(lastUse, it->lastUse);
+        if (it->fileName == fileName)
+            existing = it;
+    }
+
+    if (existing == entries.end()) {
+        Entry entry;
+        entry.fileName = fileName;
+        entries.push_back(entry);
+        existing = entries.end() - 1;
+    }
+    existing->size = size;
+    existing->lastUse = lastUse + 1;
+}
+
+} // namespace voreen
@@ -0,0 +1,65 @@
+#include "modules/tnm093/include/tnm_featureregistry.h"
+
+#include "voreen/core/ports/port.h"
+#include "voreen/core/processors/processor.h"
+
+#include <vector>
+
+namespace voreen {
+
+namespace {
+    // The descriptors in the order of the FeatureId enum
+    const FeatureDescriptor FEATURE_DESCRIPTORS[NUM_FEATURES] = {
+        { "intensity", "Intensity" },
+        { "average", "Average" },
+        { "stdDeviation", "Standard Deviation" },
+        { "gradientMagnitude", "Gradient Magnitude" },
+        { "laplacian", "Laplacian" }
+    };
+}
+
+const FeatureDescriptor& featureDescriptor(int feature) {
+    return FEATURE_DESCRIPTORS[feature];
+}
+
+std::string featureNames(FeatureMask features) {
+    std::string names;
+    for (int i = 0; i < NUM_FEATURES; ++i) {
+        if (features & featureBit(i)) {
+            if (!names.empty())
+                names += ", ";
+            names += FEATURE_DESCRIPTORS[i].name;
+        }
+    }
+    return names;
+}
+
+FeatureMask collectRequiredFeatures(const Port* outport) {
+    const std::vector<Port*> connected = outport->getConnected();
+    if (connected.empty())
+        return FEATURES_DEFAULT;
+
+    FeatureMask features = 0;
+    for (size_t i = 0; i < connected.size(); ++i) {
+        const TNMFeatureConsumer* consumer = dynamic_cast<const TNMFeatureConsumer*>(connected[i]->getProcessor());
+        features |= consumer ? consumer->getRequiredFeatures() : FEATURES_DEFAULT;
+    }
+    return features;
+}
+
+void invalidateFeatureSources(const Port* inport) {
+    const std::vector<Port*> connected = inport->getConnected();
+    for (size_t i = 0; i < connected.size(); ++i) {
+        Processor* source = connected[i]->getProcessor();
+        source->invalidate();
+
+        // A consumer between us and the extraction passes the request on
+        if (dynamic_cast<TNMFeatureConsumer*>(source)) {
+            const std::vector<Port*> inports = source->getInports();
+            for (size_t j = 0; j < inports.size(); ++j)
+                invalidateFeatureSources(inports[j]);
+        }
+    }
+}
+
+} // namespace voreen
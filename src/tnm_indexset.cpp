@@ -0,0 +1,599 @@
+#include "modules/tnm093/include/tnm_indexset.h"
+
+#include <algorithm>
+#include <iterator>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace voreen {
+
+namespace {
+    typedef IndexSet::Container Container;
+    typedef IndexSet::Run Run;
+
+    // The number of lower index values in a chunk
+    const uint32_t CHUNK_SIZE = 1u << IndexSet::CHUNK_BITS;
+    // The number of 64-bit words of a bitmap container
+    const size_t BITMAP_WORDS = CHUNK_SIZE / 64;
+    // An array container with more values would be larger than a bitmap container
+    const uint32_t ARRAY_LIMIT = CHUNK_SIZE / 16;
+    // Erasing from a bitmap container only converts it back to an array below this size, so
+    // that inserting and erasing around ARRAY_LIMIT (e.g. the edge of a brush that jitters
+    // across a dense chunk) does not convert the container with every operation. optimize()
+    // still converts to the smallest type
+    const uint32_t ARRAY_SHRINK_LIMIT = ARRAY_LIMIT / 2;
+    // A run container with more runs would be larger than a bitmap container
+    const size_t RUN_LIMIT = CHUNK_SIZE / 32;
+
+    // The operations that combine two containers
+    enum Operation {
+        OPERATION_UNION = 0,
+        OPERATION_INTERSECTION,
+        OPERATION_DIFFERENCE
+    };
+
+    inline int popcount(uint64_t word) {
+#ifdef _MSC_VER
+        return static_cast<int>(__popcnt64(word));
+#else
+        return __builtin_popcountll(word);
+#endif
+    }
+
+    // The position of the lowest set bit; 'word' must not be 0
+    inline int trailingZeros(uint64_t word) {
+#ifdef _MSC_VER
+        unsigned long bit;
+        _BitScanForward64(&bit, word);
+        return static_cast<int>(bit);
+#else
+        return __builtin_ctzll(word);
+#endif
+    }
+
+    // Orders a value and a run by the start of the run
+    struct RunStartLess {
+        bool operator()(uint32_t value, const Run& run) const { return value < run.start; }
+    };
+
+    // Returns the first bit at or after 'from' that is set (or unset if 'set' is false), or
+    // CHUNK_SIZE if there is none
+    uint32_t findBit(const std::vector<uint64_t>& words, uint32_t from, bool set) {
+        if (from >= CHUNK_SIZE)
+            return CHUNK_SIZE;
+        size_t w = from / 64;
+        uint64_t word = (set ? words[w] : ~words[w]) & (~uint64_t(0) << (from % 64));
+        while (word == 0) {
+            if (++w == BITMAP_WORDS)
+                return CHUNK_SIZE;
+            word = set ? words[w] : ~words[w];
+        }
+        return static_cast<uint32_t>(w * 64 + trailingZeros(word));
+    }
+
+    // Sets the bits [start, last]
+    void setBits(std::vector<uint64_t>& words, uint32_t start, uint32_t last) {
+        const size_t firstWord = start / 64;
+        const size_t lastWord = last / 64;
+        for (size_t w = firstWord; w <= lastWord; ++w) {
+            uint64_t mask = ~uint64_t(0);
+            if (w == firstWord)
+                mask &= ~uint64_t(0) << (start % 64);
+            if (w == lastWord)
+                mask &= ~uint64_t(0) >> (63 - last % 64);
+            words[w] |= mask;
+        }
+    }
+
+    // The number of runs of consecutive set bits
+    size_t countRuns(const std::vector<uint64_t>& words) {
+        size_t runs = 0;
+        uint64_t carry = 0; // The highest bit of the previous word
+        for (size_t w = 0; w < BITMAP_WORDS; ++w) {
+            // A run starts at every set bit whose predecessor is not set
+            runs += popcount(words[w] & ~((words[w] << 1) | carry));
+            carry = words[w] >> 63;
+        }
+        return runs;
+    }
+
+    // The number of runs of consecutive values in a sorted array
+    size_t countRuns(const std::vector<uint16_t>& values) {
+        size_t runs = values.empty() ? 0 : 1;
+        for (size_t i = 1; i < values.size(); ++i) {
+            if (values[i] != values[i - 1] + 1)
+                ++runs;
+        }
+        return runs;
+    }
+
+    // The type of the smallest container for 'cardinality' values in 'numRuns' runs
+    Container::Type smallestType(uint32_t cardinality, size_t numRuns) {
+        const size_t arrayBytes = cardinality * sizeof(uint16_t);
+        const size_t bitmapBytes = BITMAP_WORDS * sizeof(uint64_t);
+        const size_t runBytes = numRuns * sizeof(Run);
+        if (runBytes < std::min(arrayBytes, bitmapBytes))
+            return Container::TYPE_RUNS;
+        return (cardinality <= ARRAY_LIMIT) ? Container::TYPE_ARRAY : Container::TYPE_BITMAP;
+    }
+
+    bool containsValue(const Container& container, uint32_t value) {
+        switch (container.type) {
+            case Container::TYPE_BITMAP:
+                return (container.words[value / 64] >> (value % 64)) & 1;
+            case Container::TYPE_RUNS: {
+                std::vector<Run>::const_iterator it = std::upper_bound(container.runs.begin(), container.runs.end(), value, RunStartLess());
+                return (it != container.runs.begin()) && ((it - 1)->last >= value);
+            }
+            default:
+                return std::binary_search(container.values.begin(), container.values.end(), static_cast<uint16_t>(value));
+        }
+    }
+
+    // Expands the values of a container of any type into a bitmap
+    void toBitmap(const Container& container, std::vector<uint64_t>& words) {
+        if (container.type == Container::TYPE_BITMAP) {
+            words = container.words;
+            return;
+        }
+        words.assign(BITMAP_WORDS, 0);
+        if (container.type == Container::TYPE_RUNS) {
+            for (size_t i = 0; i < container.runs.size(); ++i)
+                setBits(words, container.runs[i].start, container.runs[i].last);
+        }
+        else {
+            for (size_t i = 0; i < container.values.size(); ++i)
+                words[container.values[i] / 64] |= uint64_t(1) << (container.values[i] % 64);
+        }
+    }
+
+    // Fills 'container' with the set bits of 'words' as a container of 'type'
+    void fromBitmap(const std::vector<uint64_t>& words, uint32_t cardinality, Container::Type type, Container& container) {
+        container.type = type;
+        container.cardinality = cardinality;
+        std::vector<uint16_t>().swap(container.values);
+        std::vector<uint64_t>().swap(container.words);
+        std::vector<Run>().swap(container.runs);
+
+        if (type == Container::TYPE_BITMAP) {
+            container.words = words;
+        }
+        else if (type == Container::TYPE_RUNS) {
+            for (uint32_t start = findBit(words, 0, true); start < CHUNK_SIZE; ) {
+                const uint32_t end = findBit(words, start, false);
+                const Run run = { static_cast<uint16_t>(start), static_cast<uint16_t>(end - 1) };
+                container.runs.push_back(run);
+                start = findBit(words, end, true);
+            }
+        }
+        else {
+            container.values.reserve(cardinality);
+            for (size_t w = 0; w < BITMAP_WORDS; ++w) {
+                for (uint64_t word = words[w]; word != 0; word &= word - 1)
+                    container.values.push_back(static_cast<uint16_t>(w * 64 + trailingZeros(word)));
+            }
+        }
+    }
+
+    // Changes the representation of 'container' to 'type'
+    void convert(Container& container, Container::Type type) {
+        if (container.type == type)
+            return;
+        std::vector<uint64_t> words;
+        toBitmap(container, words);
+        fromBitmap(words, container.cardinality, type, container);
+    }
+
+    bool insertValue(Container& container, uint32_t value) {
+        switch (container.type) {
+            case Container::TYPE_BITMAP: {
+                uint64_t& word = container.words[value / 64];
+                const uint64_t bit = uint64_t(1) << (value % 64);
+                if (word & bit)
+                    return false;
+                word |= bit;
+                break;
+            }
+            case Container::TYPE_RUNS: {
+                std::vector<Run>& runs = container.runs;
+                const size_t next = std::upper_bound(runs.begin(), runs.end(), value, RunStartLess()) - runs.begin();
+                const bool hasPrevious = next > 0;
+                if (hasPrevious && runs[next - 1].last >= value)
+                    return false;
+                // The value either extends a neighboring run, joins two runs or starts a new one
+                const bool extendsPrevious = hasPrevious && (runs[next - 1].last + 1u == value);
+                const bool extendsNext = (next < runs.size()) && (runs[next].start == value + 1);
+                if (extendsPrevious && extendsNext) {
+                    runs[next - 1].last = runs[next].last;
+                    runs.erase(runs.begin() + next);
+                }
+                else if (extendsPrevious)
+                    runs[next - 1].last = static_cast<uint16_t>(value);
+                else if (extendsNext)
+                    runs[next].start = static_cast<uint16_t>(value);
+                else {
+                    const Run run = { static_cast<uint16_t>(value), static_cast<uint16_t>(value) };
+                    runs.insert(runs.begin() + next, run);
+                }
+                ++container.cardinality;
+                if (runs.size() > RUN_LIMIT)
+                    convert(container, Container::TYPE_BITMAP);
+                return true;
+            }
+            default: {
+                std::vector<uint16_t>& values = container.values;
+                std::vector<uint16_t>::iterator it = std::lower_bound(values.begin(), values.end(), static_cast<uint16_t>(value));
+                if (it != values.end() && *it == value)
+                    return false;
+                values.insert(it, static_cast<uint16_t>(value));
+                ++container.cardinality;
+                if (container.cardinality > ARRAY_LIMIT)
+                    convert(container, Container::TYPE_BITMAP);
+                return true;
+            }
+        }
+        ++container.cardinality;
+        return true;
+    }
+
+    bool eraseValue(Container& container, uint32_t value) {
+        switch (container.type) {
+            case Container::TYPE_BITMAP: {
+                uint64_t& word = container.words[value / 64];
+                const uint64_t bit = uint64_t(1) << (value % 64);
+                if ((word & bit) == 0)
+                    return false;
+                word &= ~bit;
+                --container.cardinality;
+                if (container.cardinality < ARRAY_SHRINK_LIMIT)
+                    convert(container, Container::TYPE_ARRAY);
+                return true;
+            }
+            case Container::TYPE_RUNS: {
+                std::vector<Run>& runs = container.runs;
+                const size_t next = std::upper_bound(runs.begin(), runs.end(), value, RunStartLess()) - runs.begin();
+                if (next == 0 || runs[next - 1].last < value)
+                    return false;
+                // The value is removed from the run that contains it, which may split the run
+                Run& run = runs[next - 1];
+                if (run.start == run.last)
+                    runs.erase(runs.begin() + (next - 1));
+                else if (run.start == value)
+                    ++run.start;
+                else if (run.last == value)
+                    --run.last;
+                else {
+                    const Run tail = { static_cast<uint16_t>(value + 1), run.last };
+                    run.last = static_cast<uint16_t>(value - 1);
+                    runs.insert(runs.begin() + next, tail);
+                }
+                --container.cardinality;
+                if (runs.size() > RUN_LIMIT)
+                    convert(container, Container::TYPE_BITMAP);
+                return true;
+            }
+            default: {
+                std::vector<uint16_t>& values = container.values;
+                std::vector<uint16_t>::iterator it = std::lower_bound(values.begin(), values.end(), static_cast<uint16_t>(value));
+                if (it == values.end() || *it != value)
+                    return false;
+                values.erase(it);
+                --container.cardinality;
+                return true;
+            }
+        }
+    }
+
+    // Combines the values of two containers
+    void combine(const Container& lhs, const Container& rhs, Operation operation, Container& result) {
+        if (lhs.type == Container::TYPE_ARRAY && rhs.type == Container::TYPE_ARRAY) {
+            // Two arrays are merged directly
+            std::vector<uint16_t> values;
+            std::back_insert_iterator<std::vector<uint16_t> > out(values);
+            if (operation == OPERATION_UNION)
+                std::set_union(lhs.values.begin(), lhs.values.end(), rhs.values.begin(), rhs.values.end(), out);
+            else if (operation == OPERATION_INTERSECTION)
+                std::set_intersection(lhs.values.begin(), lhs.values.end(), rhs.values.begin(), rhs.values.end(), out);
+            else
+                std::set_difference(lhs.values.begin(), lhs.values.end(), rhs.values.begin(), rhs.values.end(), out);
+            result = Container();
+            result.values.swap(values);
+            result.cardinality = static_cast<uint32_t>(result.values.size());
+            if (result.cardinality > ARRAY_LIMIT)
+                convert(result, Container::TYPE_BITMAP);
+            return;
+        }
+
+        // All other combinations go through the bitmaps, one word at a time
+        std::vector<uint64_t> words;
+        std::vector<uint64_t> otherWords;
+        toBitmap(lhs, words);
+        toBitmap(rhs, otherWords);
+        uint32_t cardinality = 0;
+        for (size_t w = 0; w < BITMAP_WORDS; ++w) {
+            if (operation == OPERATION_UNION)
+                words[w] |= otherWords[w];
+            else if (operation == OPERATION_INTERSECTION)
+                words[w] &= otherWords[w];
+            else
+                words[w] &= ~otherWords[w];
+            cardinality += popcount(words[w]);
+        }
+        // Runs are kept if one of the operands consists of runs, as the result most likely does too
+        const bool keepRuns = (lhs.type == Container::TYPE_RUNS) || (rhs.type == Container::TYPE_RUNS);
+        Container::Type type = (cardinality <= ARRAY_LIMIT) ? Container::TYPE_ARRAY : Container::TYPE_BITMAP;
+        if (keepRuns)
+            type = smallestType(cardinality, countRuns(words));
+        fromBitmap(words, cardinality, type, result);
+    }
+}
+
+IndexSet::IndexSet() {}
+
+size_t IndexSet::size() const {
+    size_t result = 0;
+    for (size_t i = 0; i < _containers.size(); ++i)
+        result += _containers[i].get().cardinality;
+    return result;
+}
+
+void IndexSet::clear() {
+    _keys.clear();
+    _containers.clear();
+}
+
+size_t IndexSet::findChunk(uint64_t key) const {
+    std::vector<uint64_t>::const_iterator it = std::lower_bound(_keys.begin(), _keys.end(), key);
+    return (it != _keys.end() && *it == key) ? static_cast<size_t>(it - _keys.begin()) : _keys.size();
+}
+
+void IndexSet::removeIfEmpty(size_t position) {
+    if (_containers[position].get().cardinality == 0) {
+        _keys.erase(_keys.begin() + position);
+        _containers.erase(_containers.begin() + position);
+    }
+}
+
+bool IndexSet::contains(VoxelIndex index) const {
+    const size_t chunk = findChunk(index >> CHUNK_BITS);
+    return (chunk != _keys.size()) && containsValue(_containers[chunk].get(), static_cast<uint32_t>(index & (CHUNK_SIZE - 1)));
+}
+
+bool IndexSet::insert(VoxelIndex index) {
+    const uint64_t key = index >> CHUNK_BITS;
+    const size_t position = std::lower_bound(_keys.begin(), _keys.end(), key) - _keys.begin();
+    if (position == _keys.size() || _keys[position] != key) {
+        _keys.insert(_keys.begin() + position, key);
+        _containers.insert(_containers.begin() + position, CopyOnWrite<Container>());
+    }
+    // Only the container is copied if it is shared, and only if the index is not in it yet
+    const uint32_t value = static_cast<uint32_t>(index & (CHUNK_SIZE - 1));
+    if (containsValue(_containers[position].get(), value))
+        return false;
+    return insertValue(_containers[position].edit(), value);
+}
+
+bool IndexSet::erase(VoxelIndex index) {
+    const size_t position = findChunk(index >> CHUNK_BITS);
+    const uint32_t value = static_cast<uint32_t>(index & (CHUNK_SIZE - 1));
+    if (position == _keys.size() || !containsValue(_containers[position].get(), value))
+        return false;
+    eraseValue(_containers[position].edit(), value);
+    removeIfEmpty(position);
+    return true;
+}
+
+void IndexSet::unite(const IndexSet& other) {
+    std::vector<uint64_t> keys;
+    std::vector<CopyOnWrite<Container> > containers;
+    keys.reserve(_keys.size() + other._keys.size());
+    containers.reserve(_keys.size() + other._keys.size());
+
+    // The chunks of both sets are merged; chunks that are only in one set are shared, not copied
+    size_t i = 0;
+    size_t j = 0;
+    while (i < _keys.size() || j < other._keys.size()) {
+        if (j == other._keys.size() || (i < _keys.size() && _keys[i] < other._keys[j])) {
+            keys.push_back(_keys[i]);
+            containers.push_back(_containers[i++]);
+        }
+        else if (i == _keys.size() || other._keys[j] < _keys[i]) {
+            keys.push_back(other._keys[j]);
+            containers.push_back(other._containers[j++]);
+        }
+        else {
+            keys.push_back(_keys[i]);
+            if (_containers[i].sharesWith(other._containers[j]))
+                containers.push_back(_containers[i]);
+            else {
+                containers.push_back(CopyOnWrite<Container>());
+                combine(_containers[i].get(), other._containers[j].get(), OPERATION_UNION, containers.back().edit());
+            }
+            ++i;
+            ++j;
+        }
+    }
+    _keys.swap(keys);
+    _containers.swap(containers);
+}
+
+void IndexSet::intersect(const IndexSet& other) {
+    std::vector<uint64_t> keys;
+    std::vector<CopyOnWrite<Container> > containers;
+
+    // Only the chunks that are in both sets can keep indices
+    size_t j = 0;
+    for (size_t i = 0; i < _keys.size(); ++i) {
+        while (j < other._keys.size() && other._keys[j] < _keys[i])
+            ++j;
+        if (j == other._keys.size())
+            break;
+        if (other._keys[j] != _keys[i])
+            continue;
+
+        if (_containers[i].sharesWith(other._containers[j])) {
+            keys.push_back(_keys[i]);
+            containers.push_back(_containers[i]);
+            continue;
+        }
+        CopyOnWrite<Container> container;
+        combine(_containers[i].get(), other._containers[j].get(), OPERATION_INTERSECTION, container.edit());
+        if (container.get().cardinality > 0) {
+            keys.push_back(_keys[i]);
+            containers.push_back(container);
+        }
+    }
+    _keys.swap(keys);
+    _containers.swap(containers);
+}
+
+void IndexSet::subtract(const IndexSet& other) {
+    std::vector<uint64_t> keys;
+    std::vector<CopyOnWrite<Container> > containers;
+
+    // Chunks that are not in 'other' are kept as they are
+    size_t j = 0;
+    for (size_t i = 0; i < _keys.size(); ++i) {
+        while (j < other._keys.size() && other._keys[j] < _keys[i])
+            ++j;
+        if (j == other._keys.size() || other._keys[j] != _keys[i]) {
+            keys.push_back(_keys[i]);
+            containers.push_back(_containers[i]);
+            continue;
+        }
+        if (_containers[i].sharesWith(other._containers[j]))
+            continue;
+
+        CopyOnWrite<Container> container;
+        combine(_containers[i].get(), other._containers[j].get(), OPERATION_DIFFERENCE, container.edit());
+        if (container.get().cardinality > 0) {
+            keys.push_back(_keys[i]);
+            containers.push_back(container);
+        }
+    }
+    _keys.swap(keys);
+    _containers.swap(containers);
+}
+
+void IndexSet::optimize() {
+    for (size_t i = 0; i < _containers.size(); ++i) {
+        // The type is determined without modifying the container, so that containers which are
+        // shared and already have the smallest type are not copied
+        const Container& container = _containers[i].get();
+        size_t numRuns = container.runs.size();
+        if (container.type == Container::TYPE_ARRAY)
+            numRuns = countRuns(container.values);
+        else if (container.type == Container::TYPE_BITMAP)
+            numRuns = countRuns(container.words);
+
+        const Container::Type type = smallestType(container.cardinality, numRuns);
+        if (type != container.type)
+            convert(_containers[i].edit(), type);
+    }
+}
+
+size_t IndexSet::sizeInBytes() const {
+    size_t result = _keys.size() * (sizeof(uint64_t) + sizeof(CopyOnWrite<Container>) + sizeof(Container));
+    for (size_t i = 0; i < _containers.size(); ++i) {
+        const Container& container = _containers[i].get();
+        result += container.values.capacity() * sizeof(uint16_t) + container.words.capacity() * sizeof(uint64_t) +
+            container.runs.capacity() * sizeof(Run);
+    }
+    return result;
+}
+
+bool IndexSet::operator==(const IndexSet& other) const {
+    if (_keys != other._keys)
+        return false;
+    for (size_t i = 0; i < _containers.size(); ++i) {
+        if (_containers[i].sharesWith(other._containers[i]))
+            continue;
+        const Container& lhs = _containers[i].get();
+        const Container& rhs = other._containers[i].get();
+        if (lhs.cardinality != rhs.cardinality)
+            return false;
+        if (lhs.type == Container::TYPE_ARRAY && rhs.type == Container::TYPE_ARRAY) {
+            if (lhs.values != rhs.values)
+                return false;
+            continue;
+        }
+        // Containers of different types are compared as bitmaps
+        std::vector<uint64_t> words;
+        std::vector<uint64_t> otherWords;
+        toBitmap(lhs, words);
+        toBitmap(rhs, otherWords);
+        if (words != otherWords)
+            return false;
+    }
+    return true;
+}
+
+IndexSet::const_iterator IndexSet::begin() const {
+    return const_iterator(this, 0);
+}
+
+IndexSet::const_iterator IndexSet::end() const {
+    return const_iterator(this, _keys.size());
+}
+
+IndexSet::const_iterator::const_iterator(const IndexSet* set, size_t chunk)
+    : _set(set)
+    , _chunk(chunk)
+    , _position(0)
+    , _low(0)
+{
+    enterChunk();
+}
+
+void IndexSet::const_iterator::enterChunk() {
+    _position = 0;
+    _low = 0;
+    if (_chunk >= _set->_keys.size()) {
+        _chunk = _set->_keys.size();
+        return;
+    }
+    const Container& container = _set->_containers[_chunk].get();
+    if (container.type == Container::TYPE_BITMAP)
+        _low = findBit(container.words, 0, true);
+    else if (container.type == Container::TYPE_RUNS)
+        _low = container.runs[0].start;
+    else
+        _low = container.values[0];
+}
+
+VoxelIndex IndexSet::const_iterator::operator*() const {
+    return (static_cast<VoxelIndex>(_set->_keys[_chunk]) << CHUNK_BITS) | _low;
+}
+
+IndexSet::const_iterator& IndexSet::const_iterator::operator++() {
+    const Container& container = _set->_containers[_chunk].get();
+    bool chunkDone = false;
+    if (container.type == Container::TYPE_BITMAP) {
+        _low = findBit(container.words, _low + 1, true);
+        chunkDone = (_low == CHUNK_SIZE);
+    }
+    else if (container.type == Container::TYPE_RUNS) {
+        if (_low < container.runs[_position].last)
+            ++_low;
+        else if (++_position < container.runs.size())
+            _low = container.runs[_position].start;
+        else
+            chunkDone = true;
+    }
+    else {
+        if (++_position < container.values.size())
+            _low = container.values[_position];
+        else
+            chunkDone = true;
+    }
+
+    if (chunkDone) {
+        ++_chunk;
+        enterChunk();
+    }
+    return *this;
+}
+
+} // namespace voreen
@@ -0,0 +1,160 @@
+#include "modules/tnm093/include/tnm_integralvolume.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace voreen {
+
+template<typename T>
+IntegralVolume<T>::IntegralVolume(const T* voxels, const tgt::ivec3& dimensions, int radius)
+    : _voxels(voxels)
+    , _dimensions(dimensions)
+    , _radius(radius)
+    , _plane(-1)
+    , _zBegin(0)
+    , _zEnd(0)
+    , _columnSums(dimensions.x * dimensions.y, 0)
+    , _columnSquareSums(dimensions.x * dimensions.y, 0)
+    , _sumTable((dimensions.x + 1) * (dimensions.y + 1), 0)
+    , _squareSumTable((dimensions.x + 1) * (dimensions.y + 1), 0)
+{}
+
+template<typename T>
+void IntegralVolume<T>::setPlane(int z) {
+    const int zBegin = std::max(z - _radius, 0);
+    const int zEnd = std::min(z + _radius + 1, _dimensions.z);
+
+    if (IntegralVolumeTraits<T>::exact && _plane != -1 && z == _plane + 1) {
+        // Slide the window by one plane
+        for (int iZ = _zBegin; iZ < zBegin; ++iZ)
+            accumulatePlane(iZ, -1);
+        for (int iZ = _zEnd; iZ < zEnd; ++iZ)
+            accumulatePlane(iZ, 1);
+    }
+    else {
+        std::fill(_columnSums.begin(), _columnSums.end(), 0);
+        std::fill(_columnSquareSums.begin(), _columnSquareSums.end(), 0);
+        for (int iZ = zBegin; iZ < zEnd; ++iZ)
+            accumulatePlane(iZ, 1);
+    }
+
+    _plane = z;
+    _zBegin = zBegin;
+    _zEnd = zEnd;
+    buildTables();
+}
+
+template<typename T>
+void IntegralVolume<T>::accumulatePlane(int z, int sign) {
+    const size_t planeSize = _columnSums.size();
+    const T* plane = _voxels + z * planeSize;
+    // Integer arithmetic (even if it wraps around) makes subtracting a plane that was added
+    // before exact
+    for (size_t i = 0; i < planeSize; ++i) {
+        const Accumulator value = static_cast<Accumulator>(plane[i]);
+        if (sign > 0) {
+            _columnSums[i] += value;
+            _columnSquareSums[i] += value * value;
+        }
+        else {
+            _columnSums[i] -= value;
+            _columnSquareSums[i] -= value * value;
+        }
+    }
+}
+
+template<typename T>
+void IntegralVolume<T>::buildTables() {
+    const int tableWidth = _dimensions.x + 1;
+    // The first row and column of the tables stay 0
+    for (int y = 0; y < _dimensions.y; ++y) {
+        Accumulator rowSum = 0;
+        Accumulator rowSquareSum = 0;
+        for (int x = 0; x < _dimensions.x; ++x) {
+            rowSum += _columnSums[y * _dimensions.x + x];
+            rowSquareSum += _columnSquareSums[y * _dimensions.x + x];
+            const int t = (y + 1) * tableWidth + (x + 1);
+            _sumTable[t] = _sumTable[t - tableWidth] + rowSum;
+            _squareSumTable[t] = _squareSumTable[t - tableWidth] + rowSquareSum;
+        }
+    }
+}
+
+namespace {
+    // Computes the average and the standard deviation from the sum, the sum of squares and the
+    // number of voxels in a box.
+    // Var = (n * sum(v^2) - sum(v)^2) / n^2; for the integer accumulators the numerator is
+    // computed exactly (and is never negative), which avoids the cancellation of the naive
+    // float formula
+    inline void boxStatistics(uint64_t sum, uint64_t squareSum, uint64_t count,
+                              float& average, float& stdDeviation)
+    {
+        average = static_cast<float>(static_cast<double>(sum) / count);
+        const uint64_t numerator = count * squareSum - sum * sum;
+        stdDeviation = static_cast<float>(std::sqrt(static_cast<double>(numerator)) / count);
+    }
+
+    inline void boxStatistics(int64_t sum, int64_t squareSum, uint64_t count,
+                              float& average, float& stdDeviation)
+    {
+        average = static_cast<float>(static_cast<double>(sum) / static_cast<double>(count));
+        const int64_t numerator = static_cast<int64_t>(count) * squareSum - sum * sum;
+        stdDeviation = static_cast<float>(std::sqrt(static_cast<double>(numerator)) / count);
+    }
+
+    inline void boxStatistics(double sum, double squareSum, uint64_t count,
+                              float& average, float& stdDeviation)
+    {
+        const double n = static_cast<double>(count);
+        average = static_cast<float>(sum / n);
+        // Rounding errors can make the numerator slightly negative for constant regions
+        const double numerator = std::max(n * squareSum - sum * sum, 0.0);
+        stdDeviation = static_cast<float>(std::sqrt(numerator) / n);
+    }
+}
+
+template<typename T>
+void IntegralVolume<T>::statistics(int x, int y, float& average, float& stdDeviation) const {
+    const int x0 = std::max(x - _radius, 0);
+    const int x1 = std::min(x + _radius + 1, _dimensions.x);
+    const int y0 = std::max(y - _radius, 0);
+    const int y1 = std::min(y + _radius + 1, _dimensions.y);
+
+    const int tableWidth = _dimensions.x + 1;
+    const Accumulator sum = _sumTable[y1 * tableWidth + x1] - _sumTable[y0 * tableWidth + x1]
+        - _sumTable[y1 * tableWidth + x0] + _sumTable[y0 * tableWidth + x0];
+    const Accumulator squareSum = _squareSumTable[y1 * tableWidth + x1] - _squareSumTable[y0 * tableWidth + x1]
+        - _squareSumTable[y1 * tableWidth + x0] + _squareSumTable[y0 * tableWidth + x0];
+    const uint64_t count = static_cast<uint64_t>(x1 - x0) * (y1 - y0) * (_zEnd - _zBegin);
+
+    boxStatistics(sum, squareSum, count, average, stdDeviation);
+}
+
+template<typename T>
+void IntegralVolume<T>::rowStatistics(int y, float* averages, float* stdDeviations) const {
+    const int y0 = std::max(y - _radius, 0);
+    const int y1 = std::min(y + _radius + 1, _dimensions.y);
+    const int tableWidth = _dimensions.x + 1;
+
+    // Pointers to the table rows of the upper and lower edge of the boxes
+    const Accumulator* sumTop = &_sumTable[y0 * tableWidth];
+    const Accumulator* sumBottom = &_sumTable[y1 * tableWidth];
+    const Accumulator* squareSumTop = &_squareSumTable[y0 * tableWidth];
+    const Accumulator* squareSumBottom = &_squareSumTable[y1 * tableWidth];
+    const uint64_t rowCount = static_cast<uint64_t>(y1 - y0) * (_zEnd - _zBegin);
+
+    for (int x = 0; x < _dimensions.x; ++x) {
+        const int x0 = std::max(x - _radius, 0);
+        const int x1 = std::min(x + _radius + 1, _dimensions.x);
+        const Accumulator sum = sumBottom[x1] - sumTop[x1] - sumBottom[x0] + sumTop[x0];
+        const Accumulator squareSum = squareSumBottom[x1] - squareSumTop[x1] - squareSumBottom[x0] + squareSumTop[x0];
+        boxStatistics(sum, squareSum, rowCount * (x1 - x0), averages[x], stdDeviations[x]);
+    }
+}
+
+template class IntegralVolume<uint8_t>;
+template class IntegralVolume<uint16_t>;
+template class IntegralVolume<int16_t>;
+template class IntegralVolume<float>;
+
+} // namespace voreen
@@ -1,7 +1,28 @@
 
 #include "modules/tnm093/include/tnm_parallelcoordinates.h"
 
+#include <cmath>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 namespace voreen {
+
+namespace {
+	// The features that are shown on the axes, from left to right
+	const int AXIS_FEATURES[] = { FEATURE_INTENSITY, FEATURE_AVERAGE, FEATURE_STD_DEVIATION, FEATURE_GRADIENT_MAGNITUDE };
+	const int NUM_AXES = sizeof(AXIS_FEATURES) / sizeof(AXIS_FEATURES[0]);
+
+	// The bit of the flag that is passed to the vertex shader for each line
+	const unsigned char LINE_LINKED = 2; // The line is enhanced
+
+	// The interval in milliseconds in which the results of the brushing worker are taken
+	const int BRUSHING_POLL_INTERVAL = 15;
+
+	// The distance in pixels from the cursor within which handles and lines are picked
+	const int PICKING_RADIUS = 2;
+}
     
 TNMParallelCoordinates::AxisHandle::AxisHandle(AxisHandlePosition location, int index, const tgt::vec2& position)
     : _location(location)
@@ -22,11 +43,9 @@ void TNMParallelCoordinates::AxisHandle::render() const {
     renderInternal();
 }
 
-void TNMParallelCoordinates::AxisHandle::renderPicking() const {
-	// Mapping the integer index to a float value between 1/255 and 1
-    const float color = (_index + 1) / 255.f;
-	// The picking information is rendered only in the red channel
-    glColor3f(color, 0.f, 0.f);
+void TNMParallelCoordinates::AxisHandle::renderPicking(tgt::Shader* shader) const {
+	// The index is shifted by one, as the id 0 means that no handle is under the pixel
+    shader->setUniform("handleId_", _index + 1);
     renderInternal();
 }
 
@@ -49,17 +68,55 @@ TNMParallelCoordinates::TNMParallelCoordinates()
     : RenderProcessor()
     , _inport(Port::INPORT, "in.data")
     , _outport(Port::OUTPORT, "out.image")
-    , _privatePort(Port::OUTPORT, "private.image", false, Processor::INVALID_RESULT, GL_RGBA32F)
+    , _contextLayer(Port::OUTPORT, "private.contextLayer", false, Processor::INVALID_RESULT)
+    , _linkedLayer(Port::OUTPORT, "private.linkedLayer", false, Processor::INVALID_RESULT)
     , _pickedHandle(-1)
 	, _brushingIndices("brushingIndices", "Brushing Indices")
 	, _linkingIndices("linkingIndices", "Linking Indices")
+	, _renderMode("renderMode", "Rendering")
+	, _densityBins("densityBins", "Density Bins per Axis", 128, 16, 1024)
+	, _densityCurve("densityCurve", "Density Transfer Curve")
+	, _densityExponent("densityExponent", "Density Exponent", 0.5f, 0.05f, 2.f)
+	, _shader(0)
+	, _linePickingShader(0)
+	, _handlePickingShader(0)
+	, _densityShader(0)
+	, _layerShader(0)
+	, _densityTexture(0)
+	, _densityTextureBins(0)
+	, _densityCountBins(0)
+	, _densityValid(false)
+	, _brushingTimer(this)
+	, _flagBuffer(0)
+	, _linkingChanged(true)
+	, _pickingValid(false)
+	, _linesPickable(false)
+	, _contextLayerValid(false)
+	, _linkedLayerValid(false)
+	, _layerSize(0, 0)
 {
     addPort(_inport);
     addPort(_outport);
-    addPrivateRenderPort(_privatePort);
+    addPrivateRenderPort(_contextLayer);
+    addPrivateRenderPort(_linkedLayer);
 
 	addProperty(_brushingIndices);
 	addProperty(_linkingIndices);
+	addProperty(_renderMode);
+	addProperty(_densityBins);
+	addProperty(_densityCurve);
+	addProperty(_densityExponent);
+
+	_renderMode.addOption("lines", "Lines", RENDER_LINES);
+	_renderMode.addOption("density", "Density", RENDER_DENSITY);
+	_densityCurve.addOption("linear", "Linear", CURVE_LINEAR);
+	_densityCurve.addOption("logarithmic", "Logarithmic", CURVE_LOGARITHMIC);
+	_densityCurve.addOption("power", "Power", CURVE_POWER);
+	_densityCurve.selectByValue(CURVE_LOGARITHMIC);
+
+	_renderMode.onChange(CallMemberAction<TNMParallelCoordinates>(this, &TNMParallelCoordinates::invalidateLayers));
+	_densityCurve.onChange(CallMemberAction<TNMParallelCoordinates>(this, &TNMParallelCoordinates::invalidateDensity));
+	_densityExponent.onChange(CallMemberAction<TNMParallelCoordinates>(this, &TNMParallelCoordinates::invalidateDensity));
 
     _mouseClickEvent = new EventProperty<TNMParallelCoordinates>(
         "mouse.click", "Mouse Click",
@@ -104,45 +161,195 @@ TNMParallelCoordinates::~TNMParallelCoordinates() {
     delete _mouseMoveEvent;
 }
 
+void TNMParallelCoordinates::initialize() throw (tgt::Exception) {
+    RenderProcessor::initialize();
+    _shader = ShdrMgr.loadSeparate("parallelcoordinates.vert", "parallelcoordinates.frag");
+    _linePickingShader = ShdrMgr.loadSeparate("parallelcoordinates.vert", "picking.frag");
+    _handlePickingShader = ShdrMgr.loadSeparate("parallelcoordinates_handles.vert", "picking.frag");
+    _pickingTarget.initialize();
+    _brushingWorker.start();
+    _densityShader = ShdrMgr.loadSeparate("parallelcoordinates_density.vert", "parallelcoordinates.frag");
+    _layerShader = ShdrMgr.loadSeparate("parallelcoordinates_layer.vert", "parallelcoordinates_layer.frag");
+    invalidateLayers();
+    _axisBuffers.initialize(NUM_AXES);
+    glGenBuffers(1, &_flagBuffer);
+
+    // The bins are read with texelFetch, but the texture has to be complete without mipmaps
+    glGenTextures(1, &_densityTexture);
+    glBindTexture(GL_TEXTURE_2D, _densityTexture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    _densityTextureBins = 0;
+    _densityValid = false;
+}
+
+void TNMParallelCoordinates::deinitialize() throw (tgt::Exception) {
+    ShdrMgr.dispose(_shader);
+    _shader = 0;
+    ShdrMgr.dispose(_linePickingShader);
+    _linePickingShader = 0;
+    ShdrMgr.dispose(_handlePickingShader);
+    _handlePickingShader = 0;
+    _pickingTarget.deinitialize();
+    _pickingValid = false;
+    _brushingTimer.cancel();
+    _brushingWorker.stop();
+    ShdrMgr.dispose(_densityShader);
+    _densityShader = 0;
+    ShdrMgr.dispose(_layerShader);
+    _layerShader = 0;
+    glDeleteTextures(1, &_densityTexture);
+    _densityTexture = 0;
+    std::vector<uint32_t>().swap(_densityCounts);
+    _axisBuffers.deinitialize();
+    glDeleteBuffers(1, &_flagBuffer);
+    _flagBuffer = 0;
+    _linkingChanged = true;
+    RenderProcessor::deinitialize();
+}
+
+FeatureMask TNMParallelCoordinates::getRequiredFeatures() const {
+    FeatureMask features = 0;
+    for (int k = 0; k < NUM_AXES; k++)
+        features |= featureBit(AXIS_FEATURES[k]);
+    return features;
+}
+
 void TNMParallelCoordinates::process() {
+	// Bring the vertex buffers up to date with the data; after an axis has been added, the
+	// new feature is only available once the source has extracted it
+	const Data* data = _inport.getData();
+	bool hasLines = (data != 0);
+	for (int k = 0; hasLines && k < NUM_AXES; ++k)
+		hasLines = data->hasFeature(AXIS_FEATURES[k]);
+	if (hasLines)
+		updateBuffers(*data);
+	const bool density = hasLines && (_renderMode.getValue() == RENDER_DENSITY);
+	// The histograms are counted by the worker together with the brushed voxels, and only
+	// while they are shown
+	_brushingWorker.setDensityBins(density ? _densityBins.get() : 0);
+	if (_inport.hasChanged()) {
+		// Both layers are rendered again even if there is nothing to draw, so that they are
+		// cleared when the lines are gone (no data, missing features or no items)
+		_pickingValid = false;
+		invalidateLayers();
+		// The worker rebuilds its index for the new lines and resolves the current ranges
+		_brushingWorker.setData(hasLines ? *data : Data(), AXIS_FEATURES, NUM_AXES);
+		requestBrushing();
+	}
+	publishBrushing();
+	// The picking target is only rendered when a click needs it, see renderPicking
+	const bool linesPickable = hasLines && !density;
+	if (linesPickable != _linesPickable) {
+		_linesPickable = linesPickable;
+		_pickingValid = false;
+	}
+	// For new data, the previous histograms are shown until the worker has counted the new
+	// ones, so streamed data does not flicker. Histograms from before the lines mode are
+	// outdated once the density mode is entered again, though
+	if (!density)
+		dropDensity();
+	if (density && !_densityValid) {
+		uploadDensity();
+		_contextLayerValid = false;
+	}
+	if (_outport.getSize() != _layerSize) {
+		_layerSize = _outport.getSize();
+		invalidateLayers();
+	}
+
+	// The layers are cached between frames and only rendered again if their content has changed,
+	// e.g. a click on a line only renders the linked lines. The context layer holds all lines that
+	// are not brushed, or their density
+	if (!_contextLayerValid) {
+		_contextLayer.activateTarget();
+		_contextLayer.clearTarget();
+		if (density)
+			renderDensity();
+		else if (hasLines)
+			renderLines();
+		_contextLayer.deactivateTarget();
+		_contextLayerValid = true;
+	}
+	// The linked layer holds the linked lines that are not brushed, in both modes
+	if (!_linkedLayerValid) {
+		_linkedLayer.activateTarget();
+		_linkedLayer.clearTarget();
+		if (hasLines && !_linkingList.empty())
+			drawLines(false, true);
+		_linkedLayer.deactivateTarget();
+		_linkedLayerValid = true;
+	}
+
 	// Activate the user-outport as the rendering target
     _outport.activateTarget();
 	// Clear the buffer
     _outport.clearTarget();
 
-	// Render the handles
+	// Put the linked lines over the context and render the handles on top; the handles are only
+	// a few triangles, so they are not worth a layer of their own
+	compositeLayer(_contextLayer);
+	compositeLayer(_linkedLayer);
     renderHandles();
-	// Render the parallel coordinates lines
-    renderLines();
 
 	// We are done with the visual part
     _outport.deactivateTarget();
+}
+
+void TNMParallelCoordinates::compositeLayer(RenderPort& layer) {
+	// The layers are cleared to transparent black and the lines are drawn without blending, so
+	// a pixel of the layer replaces the pixel below it unless it is empty
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+	layer.bindColorTexture(GL_TEXTURE0);
+
+	_layerShader->activate();
+	_layerShader->setUniform("layer_", 0);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	_layerShader->deactivate();
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glBlendFunc(GL_ONE, GL_ZERO);
+	glDisable(GL_BLEND);
+}
+
+void TNMParallelCoordinates::invalidateLayers() {
+	_contextLayerValid = false;
+	_linkedLayerValid = false;
+}
+
+void TNMParallelCoordinates::renderPicking() {
+	// The ids only change with the lines, the handles (which also determine the brushed
+	// lines) and the size of the outport, so most clicks can use the previous rendering
+	if (_pickingValid && _pickingTarget.getSize() == _outport.getSize())
+		return;
 
-	// Activate the internal port used for picking
-    _privatePort.activateTarget();
-	// Clear that buffer as well
-    _privatePort.clearTarget();
-	// Render the handles with the picking information encoded in the red channel
+	// Render the ids of the handles and the lines into the picking target, which has the size
+	// of the outport. In the density mode, only the handles can be picked
+    _pickingTarget.resize(_outport.getSize());
+    _pickingTarget.activate();
     renderHandlesPicking();
-	// Render the lines with the picking information encoded in the green/blue/alpha channel
-	renderLinesPicking();
-	// We are done with the private render target
-    _privatePort.deactivateTarget();
+	if (_linesPickable)
+		renderLinesPicking();
+    _pickingTarget.deactivate();
+	_pickingValid = true;
 }
 
 void TNMParallelCoordinates::handleMouseClick(tgt::MouseEvent* e) {
-	// The picking texture is the result of the previous rendering in the private render port
-    tgt::Texture* pickingTexture = _privatePort.getColorTexture();
-	// Retrieve the texture from the graphics memory and get it to the RAM
-	pickingTexture->downloadTexture();
+	// The picking target is rendered now if anything has changed since the last click. The
+	// pixel coordinates are flipped in the y direction, so we take care of that here
+    renderPicking();
+    const tgt::ivec2 screenCoords = tgt::ivec2(e->coord().x, _pickingTarget.getSize().y - 1 - e->coord().y);
 
-	// The texture coordinates are flipped in the y direction, so we take care of that here
-    const tgt::ivec2 screenCoords = tgt::ivec2(e->coord().x, pickingTexture->getDimensions().y - e->coord().y);
-	// And then go from integer pixel coordinates to [-1,1] coordinates
-    const tgt::vec2& normalizedDeviceCoordinates = (tgt::vec2(screenCoords) / tgt::vec2(_privatePort.getSize()) - 0.5f) * 2.f;
+	// Only the pixels around the cursor are read back; the closest handle and line within
+	// PICKING_RADIUS pixels are picked, as the lines are only one pixel wide
+    GLuint ids[2] = { 0, 0 };
+    _pickingTarget.requestIds(screenCoords, PICKING_RADIUS);
+    _pickingTarget.readIds(ids);
 
-	// The picking information for the handles is stored in the red color channel
-    int handleId = static_cast<int>(pickingTexture->texelAsFloat(screenCoords).r * 255 - 1);
+	// The first id is the index of the handle plus 1, so 0 becomes -1
+    int handleId = static_cast<int>(ids[0]) - 1;
 
     LINFOC("Picking", "Picked handle index: " << handleId);
     // Use the 'id' and the 'normalizedDeviceCoordinates' to move the correct handle
@@ -157,25 +364,35 @@ void TNMParallelCoordinates::handleMouseClick(tgt::MouseEvent* e) {
     // renderLinesPicking method
     const Data& data = *(_inport.getData());
     
-    int lineId = static_cast<int>(pickingTexture->texelAsFloat(screenCoords).g * data.size() * 255 - 1);
+    // The second id is the position of the line in the data plus 1, see renderLinesPicking
+    int lineId = static_cast<int>(ids[1]) - 1;
+    if (lineId >= static_cast<int>(data.size()))
+	    lineId = -1;
 
     LINFOC("Picking", "Picked line index: " << lineId);
-    if (lineId != -1)
-	    // We want to add it only if a line was clicked
-	    _linkingList.insert(lineId);
+    if (lineId != -1) {
+	    // We want to add it only if a line was clicked. An aggregated line stands for all voxels
+	    // of its super-voxel, so all of them are linked
+	    std::vector<VoxelIndex> members;
+	    data.getMemberVoxels(data.getVoxelIndex(lineId), members);
+	    _linkingList.insert(members.begin(), members.end());
+	    _linkingChanged = true;
+    }
 
     // if the right mouse button is pressed and no line is clicked, clear the list:
-    if ((e->button() == tgt::MouseEvent::MOUSE_BUTTON_RIGHT) && (lineId == -1))
+    if ((e->button() == tgt::MouseEvent::MOUSE_BUTTON_RIGHT) && (lineId == -1)) {
 	    _linkingList.clear();
+	    _linkingChanged = true;
+    }
     
     // Make the list of selected indices available to the Scatterplot
+    _linkingList.optimize();
     _linkingIndices.set(_linkingList);
 }
 
 void TNMParallelCoordinates::handleMouseMove(tgt::MouseEvent* e) {
-    tgt::Texture* pickingTexture = _privatePort.getColorTexture();
-    const tgt::ivec2 screenCoords = tgt::ivec2(e->coord().x, pickingTexture->getDimensions().y - e->coord().y);
-    const tgt::vec2& normalizedDeviceCoordinates = (tgt::vec2(screenCoords) / tgt::vec2(_privatePort.getSize()) - 0.5f) * 2.f;
+    const tgt::ivec2 screenCoords = tgt::ivec2(e->coord().x, _outport.getSize().y - 1 - e->coord().y);
+    const tgt::vec2& normalizedDeviceCoordinates = (tgt::vec2(screenCoords) / tgt::vec2(_outport.getSize()) - 0.5f) * 2.f;
     
     // Move the stored index along its axis (if it is a valid picking point)
     if(_pickedHandle > -1) {
@@ -195,90 +412,206 @@ void TNMParallelCoordinates::handleMouseMove(tgt::MouseEvent* e) {
       }
       
       _handles.at(_pickedHandle).setPosition(newPosition);
-    }
+      _pickingValid = false;
+      invalidateLayers();
 
-    // update the _brushingList with the indices of the lines that are not rendered anymore
-    _brushingList.clear();
-    
-    const Data& data = *(_inport.getData());
-    
-    for (int i = 0; i < (int) data.size(); i++) {
-      for (int k = 0; k < NUM_DATA_VALUES; k++) {
-	float y_pos = data.at(i).dataValues[k];
-	if(!(y_pos > _handles.at(k*2)._position.y && y_pos < _handles.at(k*2 + 1)._position.y)) {
-	  _brushingList.insert(data.at(i).voxelIndex);
-	}
-      }
+      // The brushed voxels and the histograms of the density mode are updated by the worker;
+      // the lines are already drawn with the new range, as the shader tests the handle
+      // positions itself
+      requestBrushing();
     }
 
-    _brushingIndices.set(_brushingList);
-    
     // This re-renders the scene (which will call process in turn)
     invalidate();
 
 }
 
+void TNMParallelCoordinates::requestBrushing() {
+    float lowerBound[NUM_AXES];
+    float upperBound[NUM_AXES];
+    for (int k = 0; k < NUM_AXES; k++) {
+        lowerBound[k] = _handles.at(k*2)._position.y;
+        upperBound[k] = _handles.at(k*2 + 1)._position.y;
+    }
+    _brushingWorker.request(lowerBound, upperBound, NUM_AXES);
+}
+
+void TNMParallelCoordinates::publishBrushing() {
+    // The worker is asked first, so a result that is finished after the question is taken below
+    const bool busy = _brushingWorker.isBusy();
+    takeBrushing();
+    if (!busy)
+        return;
+
+    // While the worker is busy, process() is called again to take the next result. Without
+    // timers, the result is awaited here
+    if (!_brushingTimer.schedule(BRUSHING_POLL_INTERVAL)) {
+        _brushingWorker.waitUntilIdle();
+        takeBrushing();
+    }
+}
+
+void TNMParallelCoordinates::takeBrushing() {
+    if (_brushingWorker.takeResult(_brushingList))
+        _brushingIndices.set(_brushingList);
+    if (_brushingWorker.takeDensity(_densityCounts, _densityCountBins))
+        _densityValid = false;
+}
+
 void TNMParallelCoordinates::handleMouseRelease(tgt::MouseEvent* e) {
  
     _pickedHandle = -1;
     
 }
 
+void TNMParallelCoordinates::updateBuffers(const Data& data) {
+    // The columns are only uploaded if the data has changed, and only the new lines if the data
+    // has been extended
+    const size_t firstNew = _axisBuffers.update(data, AXIS_FEATURES);
+    if (firstNew == data.size() && !_linkingChanged)
+        return;
+    if (firstNew != data.size())
+        _contextLayerValid = false;
+    _linkedLayerValid = false;
+
+    // The flags only depend on the data and the linked lines, so they are rebuilt if either
+    // of them changes. Brushing does not need them, as the shader tests the handle ranges
+    std::vector<unsigned char> flagData(data.size(), 0);
+    if (!_linkingList.empty()) {
+        for (size_t i = 0; i < data.size(); ++i) {
+            if (_linkingList.contains(data.getVoxelIndex(i)))
+                flagData[i] |= LINE_LINKED;
+        }
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, _flagBuffer);
+    glBufferData(GL_ARRAY_BUFFER, flagData.size(), flagData.empty() ? 0 : &flagData[0], GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    _linkingChanged = false;
+}
+
 void TNMParallelCoordinates::renderLines() {
-  const Data& data = *(_inport.getData());
- 
-  float x_width = 2.0f / (NUM_DATA_VALUES - 1);
-  
-  for (int i = 0; i < (int) data.size(); i++) {
-    if (_brushingList.find(data.at(i).voxelIndex) != _brushingList.end())
-      continue;
-    
-    glBegin(GL_LINE_STRIP);
-    
-      float x_pos = -1.0f;
-      if (_linkingList.find(data.at(i).voxelIndex) != _linkingList.end()) {
-	glColor4f(1.0f, 0.0f, 0.0f, 1.0f); 
-      }
-      else {
-	glColor4f(0.4f, 0.4f, 0.4f, 0.7f);
-      }
-      
-      for (int k = 0; k < NUM_DATA_VALUES; k++) {
-	float y_pos = data.at(i).dataValues[k];
-	glVertex2f(x_pos, y_pos);
-	x_pos += x_width;
-      }
-      
-    glEnd();
-  }
+    // All lines are drawn in the context color; the linked ones are drawn again in their own layer
+    drawLines(false);
 }
 
 void TNMParallelCoordinates::renderLinesPicking() {
-  // Use the same code to render lines (without duplicating it), but think of a way to encode the
-  // voxel identifier into the color. The red color channel is already occupied, so you have 3
-  // channels with 32-bit each at your disposal (green, blue, alpha)
-
-  const Data& data = *(_inport.getData());
-  
-  float x_width = 2.0f / (NUM_DATA_VALUES - 1);
-  
-  for (int i = 0; i < (int) data.size(); i++) {
-    if (_brushingList.find(data.at(i).voxelIndex) != _brushingList.end())
-      continue;
-    
-    float color = (data.at(i).voxelIndex + 1) / (data.size() * 255.f);
-    float x_pos = -1.0f;
-    
-    glBegin(GL_LINE_STRIP);
-      glColor4f(0.0f, color, 0.0f, 0.0f);
-      
-      for (int k = 0; k < NUM_DATA_VALUES; k++) {
-	float y_pos = data.at(i).dataValues[k];
-	glVertex2f(x_pos, y_pos);
-	x_pos += x_width;
-      }
-    glEnd();
-  }
+    // The same draw call as for the visible lines, but picking.frag writes the position of the
+    // line in the data into the second id; the first one is used by the handles
+    drawLines(true);
+}
+
+void TNMParallelCoordinates::drawLines(bool picking, bool linkedOnly) {
+    const GLsizei numLines = static_cast<GLsizei>(_axisBuffers.size());
+    if (numLines == 0)
+        return;
+
+    // Every line is one instance of a line strip with one vertex per axis. The values of the
+    // axes and the flags are per-instance attributes, which the vertex shader picks by the
+    // index of the vertex
+    for (int k = 0; k < NUM_AXES; ++k)
+        _axisBuffers.setAttribute(k, k, 1);
+    glEnableVertexAttribArray(NUM_AXES);
+    glBindBuffer(GL_ARRAY_BUFFER, _flagBuffer);
+    glVertexAttribIPointer(NUM_AXES, 1, GL_UNSIGNED_BYTE, 0, 0);
+    glVertexAttribDivisor(NUM_AXES, 1);
+
+    GLenum type;
+    GLboolean normalized;
+    float scale, offset;
+    ColumnBuffers::attributeFormat(_axisBuffers.getEncoding(), type, normalized, scale, offset);
+    tgt::vec4 lowerBound, upperBound;
+    for (int k = 0; k < NUM_AXES; ++k) {
+        lowerBound[k] = _handles.at(k*2)._position.y;
+        upperBound[k] = _handles.at(k*2 + 1)._position.y;
+    }
+
+    tgt::Shader* shader = picking ? _linePickingShader : _shader;
+    shader->activate();
+    shader->setUniform("scale_", scale);
+    shader->setUniform("offset_", offset);
+    shader->setUniform("lowerBound_", lowerBound);
+    shader->setUniform("upperBound_", upperBound);
+    shader->setUniform("linkedOnly_", linkedOnly);
+
+    glDrawArraysInstanced(GL_LINE_STRIP, 0, NUM_AXES, numLines);
+
+    shader->deactivate();
+    for (int k = 0; k <= NUM_AXES; ++k) {
+        glVertexAttribDivisor(k, 0);
+        glDisableVertexAttribArray(k);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void TNMParallelCoordinates::invalidateDensity() {
+    _densityValid = false;
+    _contextLayerValid = false;
+}
+
+void TNMParallelCoordinates::dropDensity() {
+    if (_densityCounts.empty())
+        return;
+    std::vector<uint32_t>().swap(_densityCounts);
+    _densityCountBins = 0;
+    _densityValid = false;
+}
+
+void TNMParallelCoordinates::uploadDensity() {
+    const int numBins = _densityCountBins;
+    const std::vector<uint32_t>& counts = _densityCounts;
+
+    // The transfer curve maps the counts relative to the fullest bin of all pairs to [0,1];
+    // every non-empty bin keeps a small intensity, so that outliers stay visible
+    const uint32_t maxCount = counts.empty() ? 0 : *std::max_element(counts.begin(), counts.end());
+    const DensityCurve curve = static_cast<DensityCurve>(_densityCurve.getValue());
+    const float exponent = _densityExponent.get();
+    const float minIntensity = 1.f / 255.f;
+    std::vector<float> intensities(counts.size(), 0.f);
+    for (size_t j = 0; j < counts.size(); ++j) {
+        if (counts[j] == 0)
+            continue;
+        float intensity;
+        if (curve == CURVE_LOGARITHMIC)
+            intensity = std::log(1.f + counts[j]) / std::log(1.f + maxCount);
+        else if (curve == CURVE_POWER)
+            intensity = std::pow(static_cast<float>(counts[j]) / maxCount, exponent);
+        else
+            intensity = static_cast<float>(counts[j]) / maxCount;
+        intensities[j] = std::max(intensity, minIntensity);
+    }
+
+    // Row (pair * numBins + left bin) holds the bins of the right axis
+    glBindTexture(GL_TEXTURE_2D, _densityTexture);
+    if (!intensities.empty())
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, numBins, (NUM_AXES - 1) * numBins, 0, GL_RED, GL_FLOAT, &intensities[0]);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    _densityTextureBins = intensities.empty() ? 0 : numBins;
+    _densityValid = true;
+}
+
+void TNMParallelCoordinates::renderDensity() {
+    // Until the worker has counted the histograms for a new number of bins, the previous ones
+    // are drawn
+    const int numBins = _densityTextureBins;
+
+    // Overlapping bins keep the highest intensity, so dense bundles are not washed out by
+    // the many sparse bins that cross them
+    glEnable(GL_BLEND);
+    glBlendEquation(GL_MAX);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, _densityTexture);
+
+    _densityShader->activate();
+    _densityShader->setUniform("density_", 0);
+    _densityShader->setUniform("numBins_", numBins);
+    _densityShader->setUniform("numAxes_", NUM_AXES);
+
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (NUM_AXES - 1) * numBins * numBins);
+
+    _densityShader->deactivate();
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBlendEquation(GL_FUNC_ADD);
+    glDisable(GL_BLEND);
 }
 
 void TNMParallelCoordinates::renderHandles() {
@@ -289,10 +622,12 @@ void TNMParallelCoordinates::renderHandles() {
 }
 
 void TNMParallelCoordinates::renderHandlesPicking() {
+    _handlePickingShader->activate();
     for (size_t i = 0; i < _handles.size(); ++i) {
         const AxisHandle& handle = _handles[i];
-        handle.renderPicking();
+        handle.renderPicking(_handlePickingShader);
     }
+    _handlePickingShader->deactivate();
 }
 
 
@@ -0,0 +1,150 @@
+#include "modules/tnm093/include/tnm_pickingtarget.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace voreen {
+
+namespace {
+    // The largest neighborhood that can be requested
+    const int MAX_RADIUS = 8;
+    const int MAX_REQUEST_PIXELS = (2 * MAX_RADIUS + 1) * (2 * MAX_RADIUS + 1);
+}
+
+PickingTarget::PickingTarget()
+    : _framebuffer(0)
+    , _colorBuffer(0)
+    , _pixelBuffer(0)
+    , _size(0, 0)
+    , _fence(0)
+    , _requestOrigin(0, 0)
+    , _requestSize(0, 0)
+    , _requestPosition(0, 0)
+    , _previousFramebuffer(0)
+{
+    std::fill(_previousViewport, _previousViewport + 4, 0);
+}
+
+void PickingTarget::initialize() {
+    glGenFramebuffers(1, &_framebuffer);
+    glGenRenderbuffers(1, &_colorBuffer);
+    glGenBuffers(1, &_pixelBuffer);
+
+    // The pixel buffer is large enough for the largest request, so it is only allocated once
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, _pixelBuffer);
+    glBufferData(GL_PIXEL_PACK_BUFFER, MAX_REQUEST_PIXELS * 2 * sizeof(GLuint), 0, GL_STREAM_READ);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    _size = tgt::ivec2(0, 0);
+}
+
+void PickingTarget::deinitialize() {
+    if (_fence != 0)
+        glDeleteSync(_fence);
+    _fence = 0;
+    glDeleteBuffers(1, &_pixelBuffer);
+    glDeleteRenderbuffers(1, &_colorBuffer);
+    glDeleteFramebuffers(1, &_framebuffer);
+    _pixelBuffer = 0;
+    _colorBuffer = 0;
+    _framebuffer = 0;
+    _size = tgt::ivec2(0, 0);
+}
+
+void PickingTarget::resize(const tgt::ivec2& size) {
+    if (size == _size)
+        return;
+    _size = size;
+    glBindRenderbuffer(GL_RENDERBUFFER, _colorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RG32UI, std::max(size.x, 1), std::max(size.y, 1));
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    GLint previousFramebuffer;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, _framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, _colorBuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+}
+
+void PickingTarget::activate() {
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &_previousFramebuffer);
+    glGetIntegerv(GL_VIEWPORT, _previousViewport);
+    glBindFramebuffer(GL_FRAMEBUFFER, _framebuffer);
+    glViewport(0, 0, _size.x, _size.y);
+    const GLuint background[4] = { 0, 0, 0, 0 };
+    glClearBufferuiv(GL_COLOR, 0, background);
+}
+
+void PickingTarget::deactivate() {
+    glBindFramebuffer(GL_FRAMEBUFFER, _previousFramebuffer);
+    glViewport(_previousViewport[0], _previousViewport[1], _previousViewport[2], _previousViewport[3]);
+}
+
+void PickingTarget::requestIds(const tgt::ivec2& position, int radius) {
+    // The neighborhood is clipped to the target; a position outside of it requests nothing
+    radius = std::max(0, std::min(radius, MAX_RADIUS));
+    const tgt::ivec2 begin(std::max(position.x - radius, 0), std::max(position.y - radius, 0));
+    const tgt::ivec2 end(std::min(position.x + radius + 1, _size.x), std::min(position.y + radius + 1, _size.y));
+    if (_fence != 0)
+        glDeleteSync(_fence);
+    _fence = 0;
+    if (begin.x >= end.x || begin.y >= end.y)
+        return;
+
+    _requestOrigin = begin;
+    _requestSize = end - begin;
+    _requestPosition = position - begin;
+
+    GLint previousFramebuffer;
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previousFramebuffer);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, _framebuffer);
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, _pixelBuffer);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    // With a pixel pack buffer bound, this only schedules the copy
+    glReadPixels(begin.x, begin.y, _requestSize.x, _requestSize.y, GL_RG_INTEGER, GL_UNSIGNED_INT, 0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, previousFramebuffer);
+    _fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+bool PickingTarget::idsReady() const {
+    if (_fence == 0)
+        return false;
+    GLint status = GL_UNSIGNALED;
+    glGetSynciv(_fence, GL_SYNC_STATUS, 1, 0, &status);
+    return status == GL_SIGNALED;
+}
+
+bool PickingTarget::readIds(GLuint ids[2]) {
+    if (_fence == 0)
+        return false;
+    glClientWaitSync(_fence, GL_SYNC_FLUSH_COMMANDS_BIT, std::numeric_limits<GLuint64>::max());
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, _pixelBuffer);
+    const GLsizeiptr bytes = _requestSize.x * _requestSize.y * 2 * sizeof(GLuint);
+    const GLuint* pixels = static_cast<const GLuint*>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, bytes, GL_MAP_READ_BIT));
+
+    // For each channel, the closest pixel with an id wins
+    int bestDistance[2] = { std::numeric_limits<int>::max(), std::numeric_limits<int>::max() };
+    ids[0] = 0;
+    ids[1] = 0;
+    for (int y = 0; pixels && y < _requestSize.y; ++y) {
+        for (int x = 0; x < _requestSize.x; ++x) {
+            const tgt::ivec2 offset = tgt::ivec2(x, y) - _requestPosition;
+            const int distance = offset.x * offset.x + offset.y * offset.y;
+            for (int channel = 0; channel < 2; ++channel) {
+                const GLuint id = pixels[(y * _requestSize.x + x) * 2 + channel];
+                if (id != 0 && distance < bestDistance[channel]) {
+                    ids[channel] = id;
+                    bestDistance[channel] = distance;
+                }
+            }
+        }
+    }
+    if (pixels)
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    return pixels != 0;
+}
+
+} // namespace voreen
@@ -0,0 +1,48 @@
+#include "modules/tnm093/include/tnm_refinementtimer.h"
+#include "voreen/core/processors/processor.h"
+#include "voreen/core/voreenapplication.h"
+
+namespace voreen {
+
+RefinementTimer::RefinementTimer(Processor* processor)
+    : _processor(processor)
+    , _timer(0)
+    , _scheduled(false)
+{
+    _eventHandler.addListenerToBack(this);
+}
+
+RefinementTimer::~RefinementTimer() {
+    cancel();
+    delete _timer;
+}
+
+bool RefinementTimer::schedule(int delay) {
+    if (_timer == 0 && VoreenApplication::app())
+        _timer = VoreenApplication::app()->createTimer(&_eventHandler);
+    if (_timer == 0)
+        return false;
+
+    if (!_scheduled) {
+        // The timer fires only once; the processor schedules the next step when it needs it
+        _timer->start(delay, 1);
+        _scheduled = true;
+    }
+    return true;
+}
+
+void RefinementTimer::cancel() {
+    if (_timer && _scheduled)
+        _timer->stop();
+    _scheduled = false;
+}
+
+void RefinementTimer::timerEvent(tgt::TimeEvent* /*e*/) {
+    if (!_scheduled)
+        return;
+    _scheduled = false;
+    _timer->stop();
+    _processor->invalidate();
+}
+
+} // namespace voreen
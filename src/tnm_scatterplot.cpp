@@ -1,19 +1,59 @@
 #include "modules/tnm093/include/tnm_scatterplot.h"
 
 #include <algorithm>
+#include <cmath>
 #include <limits>
+#include <sstream>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 namespace voreen {
 
+namespace {
+	// The number of values per axis that are decoded at once to find the extrema
+	const size_t DECODE_BLOCK_SIZE = 4096;
+
+	// The bits of the flag that is passed to the vertex shader for each point
+	const unsigned char POINT_BRUSHED = 1; // The point is not drawn
+	const unsigned char POINT_SELECTED = 2; // The point is enhanced
+
+	// Returns the bin of 'numBins' bins over [-1,1] that contains 'value'
+	inline int densityBin(float value, int numBins) {
+		const int bin = static_cast<int>((value + 1.f) * 0.5f * numBins);
+		return std::max(0, std::min(bin, numBins - 1));
+	}
+}
+
 TNMScatterPlot::TNMScatterPlot()
     : RenderProcessor()
     , _inport(Port::INPORT, "in.data")
     , _outport(Port::OUTPORT, "out.image")
 	, _shader(0)
+	, _densityShader(0)
     , _firstAxis("firstAxis", "First Axis")
     , _secondAxis("secondAxis", "Second Axis")
 	, _brushingIndices("brushingIndices", "Brushing Indices")
 	, _linkingIndices("linkingIndices", "Linking Indices")
+	, _renderMode("renderMode", "Rendering")
+	, _densityCurve("densityCurve", "Density Transfer Curve")
+	, _densityExponent("densityExponent", "Density Exponent", 0.5f, 0.05f, 2.f)
+	, _flagBuffer(0)
+	, _flagCapacity(0)
+	, _brushingChanged(true)
+	, _linkingChanged(true)
+	, _rangesValid(false)
+	, _scale(0.f, 0.f)
+	, _offset(0.f, 0.f)
+	, _valueScale(0.f, 0.f)
+	, _valueOffset(0.f, 0.f)
+	, _densityTexture(0)
+	, _densityValid(false)
+	, _densitySize(0, 0)
+	, _linkedPointBuffer(0)
+	, _numLinkedPoints(0)
+	, _linkedPointsValid(false)
 {
     addPort(_inport);
     addPort(_outport);
@@ -22,26 +62,78 @@ TNMScatterPlot::TNMScatterPlot()
     addProperty(_secondAxis);
 	addProperty(_brushingIndices);
 	addProperty(_linkingIndices);
+	addProperty(_renderMode);
+	addProperty(_densityCurve);
+	addProperty(_densityExponent);
+
+	_renderMode.addOption("points", "Points", RENDER_POINTS);
+	_renderMode.addOption("density", "Density", RENDER_DENSITY);
+	_densityCurve.addOption("linear", "Linear", CURVE_LINEAR);
+	_densityCurve.addOption("logarithmic", "Logarithmic", CURVE_LOGARITHMIC);
+	_densityCurve.addOption("power", "Power", CURVE_POWER);
+	_densityCurve.selectByValue(CURVE_LOGARITHMIC);
 
-	// Assign the option value "Intensity" to the value 0 etc
-    _firstAxis.addOption("0", "Intensity", 0);
-    _firstAxis.addOption("1", "Average", 1);
-    _firstAxis.addOption("2", "Standard Deviation", 2);
-    _firstAxis.addOption("3", "Gradient Magnitude", 3);
+	// Assign the option value "Intensity" to the value 0 etc; there is one option for each
+	// registered feature
+    for (int i = 0; i < NUM_FEATURES; ++i) {
+        std::ostringstream key;
+        key << i;
+        _firstAxis.addOption(key.str(), featureDescriptor(i).name, i);
+        _secondAxis.addOption(key.str(), featureDescriptor(i).name, i);
+    }
+
+    _firstAxis.onChange(CallMemberAction<TNMScatterPlot>(this, &TNMScatterPlot::requestFeatures));
+    _secondAxis.onChange(CallMemberAction<TNMScatterPlot>(this, &TNMScatterPlot::requestFeatures));
+	_brushingIndices.onChange(CallMemberAction<TNMScatterPlot>(this, &TNMScatterPlot::invalidateBrushing));
+	_linkingIndices.onChange(CallMemberAction<TNMScatterPlot>(this, &TNMScatterPlot::invalidateLinking));
+	_densityCurve.onChange(CallMemberAction<TNMScatterPlot>(this, &TNMScatterPlot::invalidateDensity));
+	_densityExponent.onChange(CallMemberAction<TNMScatterPlot>(this, &TNMScatterPlot::invalidateDensity));
+}
 
-    _secondAxis.addOption("0", "Intensity", 0);
-    _secondAxis.addOption("1", "Average", 1);
-    _secondAxis.addOption("2", "Standard Deviation", 2);
-    _secondAxis.addOption("3", "Gradient Magnitude", 3);
+FeatureMask TNMScatterPlot::getRequiredFeatures() const {
+    return featureBit(_firstAxis.getValue()) | featureBit(_secondAxis.getValue());
+}
+
+void TNMScatterPlot::requestFeatures() {
+    invalidateFeatureSources(&_inport);
 }
 
 void TNMScatterPlot::initialize() throw (tgt::Exception) {
 	// Load the shaders and return the pointer to the shader program
 	_shader = ShdrMgr.loadSeparate("scatterplot.vert", "scatterplot.frag");
+	_densityShader = ShdrMgr.loadSeparate("scatterplot_density.vert", "scatterplot_density.frag");
+	_axisBuffers.initialize(2);
+	glGenBuffers(1, &_flagBuffer);
+	_flagCapacity = 0;
+	_flaggedData = Data();
+	_rangesValid = false;
+	glGenBuffers(1, &_linkedPointBuffer);
+	_linkedPointsValid = false;
+
+	// The bins are read with texelFetch, but the texture has to be complete without mipmaps
+	glGenTextures(1, &_densityTexture);
+	glBindTexture(GL_TEXTURE_2D, _densityTexture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	_densityValid = false;
 }
 
 void TNMScatterPlot::deinitialize() throw (tgt::Exception) {
 	ShdrMgr.dispose(_shader);
+	_axisBuffers.deinitialize();
+	glDeleteBuffers(1, &_flagBuffer);
+	_flagBuffer = 0;
+	_flagCapacity = 0;
+	_flags.clear();
+	_flaggedData = Data();
+	ShdrMgr.dispose(_densityShader);
+	_densityShader = 0;
+	glDeleteBuffers(1, &_linkedPointBuffer);
+	_linkedPointBuffer = 0;
+	_numLinkedPoints = 0;
+	glDeleteTextures(1, &_densityTexture);
+	_densityTexture = 0;
 }
 
 void TNMScatterPlot::process() {
@@ -56,107 +148,275 @@ void TNMScatterPlot::process() {
 	// Access the provided data. We have already checked before that it exists, so dereferencing it here is safe
     const Data& data = *(_inport.getData());
 
-	// The set contains all indices of voxels that should be ignored
-	const std::set<unsigned int>& brushingIndices = _brushingIndices.get();
-	// The set contains all indices of voxels that should be visually selected
-	const std::set<unsigned int>& selectionIndices = _linkingIndices.get();
-
-	// The number of points is equal to the number in the original dataset minus the number we are ignoring
-	const size_t dataSize = data.size() - brushingIndices.size();
-	// There are 2 coordinate components for each point
-	const size_t nCoordinateComponents = dataSize * 2;
-
-	// The vector containing the position data
-	std::vector<float> positionData;
-	// Make room in the vector
-	positionData.resize(nCoordinateComponents); 
-
-	// The vector containing boolean flags saying for each position if it is selected
-	// OpenGL doesn't support boolean values for the vertex buffer, so we take the next best thing instead
-	std::vector<unsigned char> selectionData(dataSize, 0);
-	
-	// In order to map the value ranges to [-1,1] we need to find the mininum and maximum values
-	float minimumFirstCoordinate = std::numeric_limits<float>::max();
-	float maximumFirstCoordinate = -std::numeric_limits<float>::max();
-	float minimumSecondCoordinate = std::numeric_limits<float>::max();
-	float maximumSecondCoordinate = -std::numeric_limits<float>::max();
-	// i: index into the data
-	// j: index into the coordinates
-	for (size_t i = 0, j = 0; i < data.size(); ++i) {
-		//// See if the index i is in the vector for brushing
-		if (brushingIndices.find(data[i].voxelIndex) != brushingIndices.end())
-			// If it is, we ignore it
-			continue;
-		else {
-			// otherwise add it to the position data
-			// _firstAxis.getValue() and _secondAxis.getValue() returns the integer value specified above
-			// to determine which selection was chosen in the GUI
-			const float firstCoordinate = data[i].dataValues[_firstAxis.getValue()];
-			const float secondCoordinate = data[i].dataValues[_secondAxis.getValue()];
-			positionData[j] = firstCoordinate;
-			positionData[j+1] = secondCoordinate;
-			j += 2;
-
-			minimumFirstCoordinate = std::min(minimumFirstCoordinate, firstCoordinate);
-			maximumFirstCoordinate = std::max(maximumFirstCoordinate, firstCoordinate);
-			minimumSecondCoordinate = std::min(minimumSecondCoordinate, secondCoordinate);
-			maximumSecondCoordinate = std::max(maximumSecondCoordinate, secondCoordinate);
-		}
+	// _firstAxis.getValue() and _secondAxis.getValue() returns the integer value specified above
+	// to determine which selection was chosen in the GUI
+	const int features[2] = { _firstAxis.getValue(), _secondAxis.getValue() };
+
+	// After an axis has changed, the new feature is only available once the source has extracted it
+	if (data.empty() || !data.hasFeature(features[0]) || !data.hasFeature(features[1])) {
+		_outport.deactivateTarget();
+		return;
 	}
 
-	// In a second step, we need to normalize the found data. By now we have looked at each value and found the
-	// min/max values
-	// Normalizing the data values to the range [-1,1]
-	for (size_t i = 0; i < nCoordinateComponents; i+=2) {
-		// First normalize to [0,1]
-		positionData[i] = (positionData[i] - minimumFirstCoordinate) / (maximumFirstCoordinate - minimumFirstCoordinate);
-		positionData[i+1] = (positionData[i+1] - minimumSecondCoordinate) / (maximumSecondCoordinate - minimumSecondCoordinate);
-		
-		// Then shift the normalized values to [-1,1]
-		positionData[i] = (positionData[i] - 0.5f) * 2.f;
-		positionData[i+1] = (positionData[i+1] - 0.5f) * 2.f;
+	// The columns of the axes stay in their vbos across frames and the flags in theirs; both are
+	// only uploaded where they have changed, so a new selection only uploads some of the flags
+	const size_t firstNewColumn = _axisBuffers.update(data, features);
+	const bool flagsChanged = updateFlags(data);
+	if (firstNewColumn != data.size() || flagsChanged)
+		_rangesValid = false;
+	if (!_rangesValid) {
+		updateRanges(data, features);
+		_densityValid = false;
 	}
 
-	// Set the selection array for all selected indices
-	for (std::set<unsigned int>::const_iterator i = selectionIndices.begin();
-		i != selectionIndices.end();
-		++i) 
-	{
-		const unsigned int thisIndex = *i;
-		selectionData[thisIndex] = 1;
+	// The density has one bin per pixel, so it only depends on the size of the image and not
+	// on the number of points once it is computed; only the linked points are drawn on top
+	const bool density = (_renderMode.getValue() == RENDER_DENSITY);
+	if (density) {
+		if (!_densityValid || _outport.getSize() != _densitySize)
+			computeDensity(data, features, _outport.getSize());
+		renderDensity();
+		if (!_linkedPointsValid)
+			updateLinkedPoints();
 	}
 
 	// We want to be able to set the point size from the vertex shader
 	glEnable(GL_PROGRAM_POINT_SIZE);
 
-	// Activate, create, and fill the vbo containing the position data
-	GLuint vbo;
-	glEnableVertexAttribArray(0);
-	glGenBuffers(1, &vbo);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBufferData(GL_ARRAY_BUFFER, positionData.size() * sizeof(float), &(positionData[0]), GL_STATIC_DRAW);
-	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, 0);
-
-	// Activate, create, and fill the vbo containing the selection data
-	GLuint selectionVbo;
-	glEnableVertexAttribArray(1);
-	glGenBuffers(1, &selectionVbo);
-	glBindBuffer(GL_ARRAY_BUFFER, selectionVbo);
-	glBufferData(GL_ARRAY_BUFFER, selectionData.size() * sizeof(unsigned char), &(selectionData[0]), GL_STATIC_DRAW);
-	glVertexAttribIPointer(1, 1, GL_UNSIGNED_BYTE, 0, 0);
+	for (int axis = 0; axis < 2; ++axis)
+		_axisBuffers.setAttribute(axis, axis);
+	glEnableVertexAttribArray(2);
+	glBindBuffer(GL_ARRAY_BUFFER, _flagBuffer);
+	glVertexAttribIPointer(2, 1, GL_UNSIGNED_BYTE, 0, 0);
 
 	// Activate the shader required for rendering
 	_shader->activate();
+	_shader->setUniform("scale_", _scale);
+	_shader->setUniform("offset_", _offset);
 
 	// Draw the points
-	glDrawArrays(GL_POINTS, 0, dataSize);
+	if (density) {
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _linkedPointBuffer);
+		glDrawElements(GL_POINTS, static_cast<GLsizei>(_numLinkedPoints), GL_UNSIGNED_INT, 0);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	}
+	else
+		glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(data.size()));
 
 	// And be a good citizen and clean up
 	_shader->deactivate();
-	glDeleteBuffers(1, &vbo);
+	for (int i = 0; i < 3; ++i)
+		glDisableVertexAttribArray(i);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
 	glDisable(GL_PROGRAM_POINT_SIZE);
     _outport.deactivateTarget();
 }
 
+void TNMScatterPlot::invalidateBrushing() {
+	_brushingChanged = true;
+}
+
+void TNMScatterPlot::invalidateLinking() {
+	_linkingChanged = true;
+}
+
+bool TNMScatterPlot::updateFlags(const Data& data) {
+	// If the data has only been extended, e.g. by a progressive delivery, and the sets are the
+	// same, only the flags of the new points are computed
+	const bool setsChanged = _brushingChanged || _linkingChanged;
+	const size_t firstNew = data.extends(_flaggedData) ? _flaggedData.size() : 0;
+	const size_t begin = setsChanged ? 0 : firstNew;
+	_flaggedData = data;
+	_brushingChanged = false;
+	_linkingChanged = false;
+	if (begin == data.size() && _flags.size() == data.size())
+		return false;
+
+	// The set contains all indices of voxels that should be ignored
+	const IndexSet& brushingIndices = _brushingIndices.get();
+	// The set contains all indices of voxels that should be visually selected
+	const IndexSet& selectionIndices = _linkingIndices.get();
+
+	// One flag per item, in the same order as the items in the data. Brushed points are not
+	// removed from the vertex buffers but discarded by the vertex shader, so the columns of the
+	// data can be uploaded as they are. OpenGL doesn't support boolean values for the vertex
+	// buffer, so we take the next best thing instead
+	const size_t oldSize = (firstNew == 0) ? 0 : _flags.size();
+	_flags.resize(data.size(), 0);
+	size_t firstChanged = data.size();
+	size_t lastChanged = 0;
+	bool oldPointsChanged = false;
+	for (size_t i = begin; i < data.size(); ++i) {
+		unsigned char flag = 0;
+		if (!brushingIndices.empty() || !selectionIndices.empty()) {
+			const VoxelIndex voxelIndex = data.getVoxelIndex(i);
+			if (brushingIndices.contains(voxelIndex))
+				flag |= POINT_BRUSHED;
+			if (selectionIndices.contains(voxelIndex))
+				flag |= POINT_SELECTED;
+		}
+		if (i < oldSize && flag == _flags[i])
+			continue;
+		oldPointsChanged = oldPointsChanged || (i < oldSize && ((flag ^ _flags[i]) & POINT_BRUSHED));
+		_flags[i] = flag;
+		firstChanged = std::min(firstChanged, i);
+		lastChanged = i;
+	}
+
+	// The buffer grows geometrically, so that not every batch of a progressive delivery
+	// reallocates it; otherwise only the range of changed flags is uploaded
+	glBindBuffer(GL_ARRAY_BUFFER, _flagBuffer);
+	if (data.size() > _flagCapacity || firstNew == 0) {
+		_flagCapacity = (firstNew == 0) ? data.size() : std::max(data.size(), 2 * _flagCapacity);
+		glBufferData(GL_ARRAY_BUFFER, _flagCapacity, 0, GL_DYNAMIC_DRAW);
+		firstChanged = 0;
+		lastChanged = data.size() - 1;
+	}
+	if (firstChanged <= lastChanged) {
+		glBufferSubData(GL_ARRAY_BUFFER, firstChanged, lastChanged - firstChanged + 1, &_flags[firstChanged]);
+		_linkedPointsValid = false;
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	return oldPointsChanged;
+}
+
+void TNMScatterPlot::updateRanges(const Data& data, const int* features) {
+	// In order to map the value ranges to [-1,1] we need to find the mininum and maximum values
+	// of the points that are drawn. Only the two columns are decoded, one block at a time
+	float minimum[2] = { std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+	float maximum[2] = { -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max() };
+	std::vector<float> values(DECODE_BLOCK_SIZE);
+	for (int axis = 0; axis < 2; ++axis) {
+		for (size_t begin = 0; begin < data.size(); begin += DECODE_BLOCK_SIZE) {
+			const size_t count = std::min(DECODE_BLOCK_SIZE, data.size() - begin);
+			data.getValues(features[axis], begin, count, &values[0]);
+			for (size_t i = 0; i < count; ++i) {
+				if (_flags[begin + i] & POINT_BRUSHED)
+					continue;
+				minimum[axis] = std::min(minimum[axis], values[i]);
+				maximum[axis] = std::max(maximum[axis], values[i]);
+			}
+		}
+	}
+
+	// The normalization happens in the vertex shader: position = value * scale_ + offset_, where
+	// value is what OpenGL passes for the stored encoding. This combines decoding the value and
+	// mapping [minimum, maximum] to [-1,1]
+	GLenum type;
+	GLboolean normalized;
+	float decodeScale, decodeOffset;
+	ColumnBuffers::attributeFormat(data.getEncoding(), type, normalized, decodeScale, decodeOffset);
+	for (int axis = 0; axis < 2; ++axis) {
+		const float range = maximum[axis] - minimum[axis];
+		const float rangeScale = (range > 0.f) ? 2.f / range : 0.f;
+		const float rangeOffset = (range > 0.f) ? -2.f * minimum[axis] / range - 1.f : 0.f;
+		_scale[axis] = decodeScale * rangeScale;
+		_offset[axis] = decodeOffset * rangeScale + rangeOffset;
+		_valueScale[axis] = rangeScale;
+		_valueOffset[axis] = rangeOffset;
+	}
+	_rangesValid = true;
+}
+
+void TNMScatterPlot::invalidateDensity() {
+	_densityValid = false;
+}
+
+void TNMScatterPlot::computeDensity(const Data& data, const int* features, const tgt::ivec2& size) {
+	const int width = std::max(size.x, 1);
+	const int height = std::max(size.y, 1);
+	const size_t histogramSize = static_cast<size_t>(width) * height;
+	const size_t numItems = data.size();
+	const int numBlocks = static_cast<int>((numItems + DECODE_BLOCK_SIZE - 1) / DECODE_BLOCK_SIZE);
+
+	// Every thread bins its blocks of points into a histogram of its own, which are added up
+	// at the end, so the result does not depend on the number of threads
+	std::vector<uint32_t> counts(histogramSize, 0);
+#ifdef _OPENMP
+	#pragma omp parallel
+#endif
+	{
+		std::vector<uint32_t> localCounts(histogramSize, 0);
+		std::vector<float> values(2 * DECODE_BLOCK_SIZE);
+#ifdef _OPENMP
+		#pragma omp for schedule(static)
+#endif
+		for (int block = 0; block < numBlocks; ++block) {
+			const size_t begin = block * DECODE_BLOCK_SIZE;
+			const size_t count = std::min(DECODE_BLOCK_SIZE, numItems - begin);
+			for (int axis = 0; axis < 2; ++axis)
+				data.getValues(features[axis], begin, count, &values[axis * DECODE_BLOCK_SIZE]);
+
+			for (size_t i = 0; i < count; ++i) {
+				// Brushed points are not counted, like in the point mode
+				if (_flags[begin + i] & POINT_BRUSHED)
+					continue;
+				const int x = densityBin(values[i] * _valueScale.x + _valueOffset.x, width);
+				const int y = densityBin(values[DECODE_BLOCK_SIZE + i] * _valueScale.y + _valueOffset.y, height);
+				++localCounts[static_cast<size_t>(y) * width + x];
+			}
+		}
+#ifdef _OPENMP
+		#pragma omp critical(TNMScatterPlot_mergeDensity)
+#endif
+		{
+			for (size_t j = 0; j < counts.size(); ++j)
+				counts[j] += localCounts[j];
+		}
+	}
+
+	// The transfer curve maps the counts relative to the fullest bin to [0,1]; every non-empty
+	// bin keeps a small intensity, so that outliers stay visible
+	const uint32_t maxCount = *std::max_element(counts.begin(), counts.end());
+	const DensityCurve curve = static_cast<DensityCurve>(_densityCurve.getValue());
+	const float exponent = _densityExponent.get();
+	const float minIntensity = 1.f / 255.f;
+	std::vector<float> intensities(counts.size(), 0.f);
+	for (size_t j = 0; j < counts.size(); ++j) {
+		if (counts[j] == 0)
+			continue;
+		float intensity;
+		if (curve == CURVE_LOGARITHMIC)
+			intensity = std::log(1.f + counts[j]) / std::log(1.f + maxCount);
+		else if (curve == CURVE_POWER)
+			intensity = std::pow(static_cast<float>(counts[j]) / maxCount, exponent);
+		else
+			intensity = static_cast<float>(counts[j]) / maxCount;
+		intensities[j] = std::max(intensity, minIntensity);
+	}
+
+	glBindTexture(GL_TEXTURE_2D, _densityTexture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, width, height, 0, GL_RED, GL_FLOAT, &intensities[0]);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	_densityValid = true;
+	_densitySize = size;
+}
+
+void TNMScatterPlot::renderDensity() {
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, _densityTexture);
+
+	_densityShader->activate();
+	_densityShader->setUniform("density_", 0);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	_densityShader->deactivate();
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void TNMScatterPlot::updateLinkedPoints() {
+	std::vector<GLuint> positions;
+	for (size_t i = 0; i < _flags.size(); ++i) {
+		if ((_flags[i] & (POINT_BRUSHED | POINT_SELECTED)) == POINT_SELECTED)
+			positions.push_back(static_cast<GLuint>(i));
+	}
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _linkedPointBuffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, positions.size() * sizeof(GLuint), positions.empty() ? 0 : &positions[0], GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	_numLinkedPoints = positions.size();
+	_linkedPointsValid = true;
+}
+
 
 } // namespace
@@ -0,0 +1,260 @@
+#include "modules/tnm093/include/tnm_scatterplotmatrix.h"
+
+#include <algorithm>
+#include <limits>
+#include <sstream>
+
+namespace voreen {
+
+namespace {
+	// The number of values per feature that are decoded at once to find the extrema
+	const size_t DECODE_BLOCK_SIZE = 4096;
+
+	// The bits of the flag that is passed to the vertex shader for each point
+	const unsigned char POINT_BRUSHED = 1; // The point is not drawn
+	const unsigned char POINT_SELECTED = 2; // The point is enhanced
+
+	// The header of the shaders, which defines the number of features in the matrix
+	std::string generateShaderHeader(int numFeatures) {
+		std::ostringstream header;
+		header << "#version 330\n";
+		header << "#define NUM_FEATURES " << numFeatures << "\n";
+		return header.str();
+	}
+}
+
+TNMScatterPlotMatrix::TNMScatterPlotMatrix()
+    : RenderProcessor()
+    , _inport(Port::INPORT, "in.data")
+    , _outport(Port::OUTPORT, "out.image")
+	, _shader(0)
+	, _shaderFeatures(0)
+	, _brushingIndices("brushingIndices", "Brushing Indices")
+	, _linkingIndices("linkingIndices", "Linking Indices")
+	, _flagBuffer(0)
+	, _flagCapacity(0)
+	, _flagsChanged(true)
+	, _rangesValid(false)
+{
+    addPort(_inport);
+    addPort(_outport);
+
+	addProperty(_brushingIndices);
+	addProperty(_linkingIndices);
+
+	_brushingIndices.onChange(CallMemberAction<TNMScatterPlotMatrix>(this, &TNMScatterPlotMatrix::invalidateFlags));
+	_linkingIndices.onChange(CallMemberAction<TNMScatterPlotMatrix>(this, &TNMScatterPlotMatrix::invalidateFlags));
+}
+
+FeatureMask TNMScatterPlotMatrix::getRequiredFeatures() const {
+    return FEATURES_ALL;
+}
+
+void TNMScatterPlotMatrix::initialize() throw (tgt::Exception) {
+	// The shader is built for all features; process() builds it again if the data stores fewer
+	_shaderFeatures = NUM_FEATURES;
+	_shader = ShdrMgr.loadSeparate("scatterplotmatrix.vert", "scatterplotmatrix.frag",
+		generateShaderHeader(_shaderFeatures), false);
+	_features.clear();
+	glGenBuffers(1, &_flagBuffer);
+	_flagCapacity = 0;
+	_flaggedData = Data();
+	_flagsChanged = true;
+	_rangesValid = false;
+}
+
+void TNMScatterPlotMatrix::deinitialize() throw (tgt::Exception) {
+	ShdrMgr.dispose(_shader);
+	_shader = 0;
+	_shaderFeatures = 0;
+	_columnBuffers.deinitialize();
+	_features.clear();
+	glDeleteBuffers(1, &_flagBuffer);
+	_flagBuffer = 0;
+	_flagCapacity = 0;
+	_flags.clear();
+	_flaggedData = Data();
+}
+
+void TNMScatterPlotMatrix::process() {
+    if (!_inport.hasData())
+        return;
+
+    _outport.activateTarget();
+    _outport.clearTarget();
+
+    const Data& data = *(_inport.getData());
+
+	// The matrix shows the features that have been extracted so far, at least two of them
+	std::vector<int> features;
+	for (int feature = 0; feature < NUM_FEATURES; ++feature) {
+		if (data.hasFeature(feature))
+			features.push_back(feature);
+	}
+	const int numFeatures = static_cast<int>(features.size());
+	if (data.empty() || numFeatures < 2) {
+		_outport.deactivateTarget();
+		return;
+	}
+
+	// The number of features is a constant of the shader, so it is built again if it changes
+	if (numFeatures != _shaderFeatures) {
+		_shader->setHeaders(generateShaderHeader(numFeatures));
+		_shader->rebuild();
+		_shaderFeatures = numFeatures;
+	}
+	if (features != _features) {
+		if (features.size() != _features.size()) {
+			_columnBuffers.deinitialize();
+			_columnBuffers.initialize(numFeatures);
+		}
+		_features = features;
+		_scale.assign(numFeatures, 0.f);
+		_offset.assign(numFeatures, 0.f);
+		_rangesValid = false;
+	}
+
+	// All columns are uploaded once; the cells only differ in which of them they read
+	const size_t firstNewColumn = _columnBuffers.update(data, &_features[0]);
+	if (updateFlags(data) || firstNewColumn != data.size())
+		_rangesValid = false;
+	if (!_rangesValid)
+		updateRanges(data);
+
+	renderFrames();
+
+	// We want to be able to set the point size from the vertex shader
+	glEnable(GL_PROGRAM_POINT_SIZE);
+
+	for (int i = 0; i < numFeatures; ++i)
+		_columnBuffers.setAttribute(i, i);
+	glEnableVertexAttribArray(numFeatures);
+	glBindBuffer(GL_ARRAY_BUFFER, _flagBuffer);
+	glVertexAttribIPointer(numFeatures, 1, GL_UNSIGNED_BYTE, 0, 0);
+
+	_shader->activate();
+	_shader->setUniform("scale_", &_scale[0], numFeatures);
+	_shader->setUniform("offset_", &_offset[0], numFeatures);
+
+	// Every instance is one cell of the matrix and draws all points; the diagonal is left out
+	glDrawArraysInstanced(GL_POINTS, 0, static_cast<GLsizei>(data.size()), numFeatures * (numFeatures - 1));
+
+	_shader->deactivate();
+	for (int i = 0; i <= numFeatures; ++i)
+		glDisableVertexAttribArray(i);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glDisable(GL_PROGRAM_POINT_SIZE);
+    _outport.deactivateTarget();
+}
+
+void TNMScatterPlotMatrix::invalidateFlags() {
+	_flagsChanged = true;
+}
+
+bool TNMScatterPlotMatrix::updateFlags(const Data& data) {
+	// If the data has only been extended and the sets are the same, only the flags of the new
+	// points are computed. New points make the caller compute the ranges again anyway
+	const size_t firstNew = data.extends(_flaggedData) ? _flaggedData.size() : 0;
+	const size_t begin = _flagsChanged ? 0 : firstNew;
+	_flaggedData = data;
+	_flagsChanged = false;
+	if (begin == data.size() && _flags.size() == data.size())
+		return false;
+
+	const IndexSet& brushingIndices = _brushingIndices.get();
+	const IndexSet& selectionIndices = _linkingIndices.get();
+	const size_t oldSize = (firstNew == 0) ? 0 : _flags.size();
+	_flags.resize(data.size(), 0);
+	size_t firstChanged = data.size();
+	size_t lastChanged = 0;
+	bool oldPointsChanged = false;
+	for (size_t i = begin; i < data.size(); ++i) {
+		unsigned char flag = 0;
+		if (!brushingIndices.empty() || !selectionIndices.empty()) {
+			const VoxelIndex voxelIndex = data.getVoxelIndex(i);
+			if (brushingIndices.contains(voxelIndex))
+				flag |= POINT_BRUSHED;
+			if (selectionIndices.contains(voxelIndex))
+				flag |= POINT_SELECTED;
+		}
+		if (i < oldSize && flag == _flags[i])
+			continue;
+		// Only brushing changes which points determine the ranges; linking only changes colors
+		oldPointsChanged = oldPointsChanged || (i < oldSize && ((flag ^ _flags[i]) & POINT_BRUSHED));
+		_flags[i] = flag;
+		firstChanged = std::min(firstChanged, i);
+		lastChanged = i;
+	}
+
+	// The buffer grows geometrically, so that not every batch of a progressive delivery
+	// reallocates it; otherwise only the range of changed flags is uploaded
+	glBindBuffer(GL_ARRAY_BUFFER, _flagBuffer);
+	if (data.size() > _flagCapacity || firstNew == 0) {
+		_flagCapacity = (firstNew == 0) ? data.size() : std::max(data.size(), 2 * _flagCapacity);
+		glBufferData(GL_ARRAY_BUFFER, _flagCapacity, 0, GL_DYNAMIC_DRAW);
+		firstChanged = 0;
+		lastChanged = data.size() - 1;
+	}
+	if (firstChanged <= lastChanged)
+		glBufferSubData(GL_ARRAY_BUFFER, firstChanged, lastChanged - firstChanged + 1, &_flags[firstChanged]);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	return oldPointsChanged;
+}
+
+void TNMScatterPlotMatrix::updateRanges(const Data& data) {
+	GLenum type;
+	GLboolean normalized;
+	float decodeScale, decodeOffset;
+	ColumnBuffers::attributeFormat(data.getEncoding(), type, normalized, decodeScale, decodeOffset);
+
+	// Every feature is mapped from the range of the points that are drawn to [-1,1], like the
+	// axes of TNMScatterPlot
+	std::vector<float> values(DECODE_BLOCK_SIZE);
+	for (size_t i = 0; i < _features.size(); ++i) {
+		const int feature = _features[i];
+		float minimum = std::numeric_limits<float>::max();
+		float maximum = -std::numeric_limits<float>::max();
+		for (size_t begin = 0; begin < data.size(); begin += DECODE_BLOCK_SIZE) {
+			const size_t count = std::min(DECODE_BLOCK_SIZE, data.size() - begin);
+			data.getValues(feature, begin, count, &values[0]);
+			for (size_t j = 0; j < count; ++j) {
+				if (_flags[begin + j] & POINT_BRUSHED)
+					continue;
+				minimum = std::min(minimum, values[j]);
+				maximum = std::max(maximum, values[j]);
+			}
+		}
+		const float range = maximum - minimum;
+		const float rangeScale = (range > 0.f) ? 2.f / range : 0.f;
+		const float rangeOffset = (range > 0.f) ? -2.f * minimum / range - 1.f : 0.f;
+		_scale[i] = decodeScale * rangeScale;
+		_offset[i] = decodeOffset * rangeScale + rangeOffset;
+	}
+	_rangesValid = true;
+}
+
+void TNMScatterPlotMatrix::renderFrames() const {
+	// The frames have the same margin as the points in the vertex shader
+	const int numFeatures = static_cast<int>(_features.size());
+	const float cellSize = 2.f / numFeatures;
+	const float margin = 0.05f * cellSize;
+	glColor3f(0.5f, 0.5f, 0.5f);
+	for (int row = 0; row < numFeatures; ++row) {
+		for (int column = 0; column < numFeatures; ++column) {
+			if (row == column)
+				continue;
+			const float left = -1.f + column * cellSize + margin;
+			const float right = -1.f + (column + 1) * cellSize - margin;
+			const float top = 1.f - row * cellSize - margin;
+			const float bottom = 1.f - (row + 1) * cellSize + margin;
+			glBegin(GL_LINE_LOOP);
+			glVertex2f(left, bottom);
+			glVertex2f(right, bottom);
+			glVertex2f(right, top);
+			glVertex2f(left, top);
+			glEnd();
+		}
+	}
+}
+
+} // namespace
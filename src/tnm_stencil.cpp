@@ -0,0 +1,221 @@
+#include "modules/tnm093/include/tnm_stencil.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TNM_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+// The AVX kernels are compiled for every x86 build and only called if the processor supports
+// AVX, so the module does not have to be built with -mavx to use them
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define TNM_USE_AVX
+#define TNM_TARGET_AVX __attribute__((target("avx")))
+#include <immintrin.h>
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define TNM_USE_AVX
+#define TNM_TARGET_AVX
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+
+namespace voreen {
+
+namespace {
+    // The scalar version of the gradient magnitude for a single voxel; xMinus and xPlus are
+    // the (clamped) x coordinates of the neighbors
+    inline float gradientMagnitude(const float* row, const float* rowYMinus, const float* rowYPlus,
+                                   const float* rowZMinus, const float* rowZPlus,
+                                   int x, int xMinus, int xPlus)
+    {
+        const float gx = (row[xPlus] - row[xMinus]) * 0.5f;
+        const float gy = (rowYPlus[x] - rowYMinus[x]) * 0.5f;
+        const float gz = (rowZPlus[x] - rowZMinus[x]) * 0.5f;
+        return std::sqrt(gx * gx + gy * gy + gz * gz);
+    }
+
+    // The scalar version of the Laplacian for a single voxel, with the same clamping as above
+    inline float laplacian(const float* row, const float* rowYMinus, const float* rowYPlus,
+                           const float* rowZMinus, const float* rowZPlus,
+                           int x, int xMinus, int xPlus)
+    {
+        const float neighbors = ((row[xMinus] + row[xPlus]) + (rowYMinus[x] + rowYPlus[x])) +
+            (rowZMinus[x] + rowZPlus[x]);
+        return neighbors - 6.f * row[x];
+    }
+
+#ifdef TNM_USE_AVX
+    // Returns true if the processor and the operating system support AVX
+    bool detectAvx() {
+#if defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 1);
+        // AVX itself and OSXSAVE, which is needed to check that the OS saves the AVX registers
+        const bool cpuHasAvx = ((info[2] & (1 << 28)) != 0) && ((info[2] & (1 << 27)) != 0);
+        return cpuHasAvx && ((_xgetbv(0) & 6) == 6);
+#else
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx") != 0;
+#endif
+    }
+
+    // The result of detectAvx(), which is only queried once
+    bool hasAvx() {
+        static const bool avx = detectAvx();
+        return avx;
+    }
+
+    // Computes the gradient magnitude of 8 voxels at a time, starting at x, as long as the
+    // voxels have both neighbors in x; returns the first x that has not been computed
+    TNM_TARGET_AVX int gradientMagnitudeRowAvx(const float* row, const float* rowYMinus, const float* rowYPlus,
+                                               const float* rowZMinus, const float* rowZPlus, int x, int dimX,
+                                               float* result)
+    {
+        const __m256 half = _mm256_set1_ps(0.5f);
+        for (; x + 8 <= dimX - 1; x += 8) {
+            const __m256 gx = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(row + x + 1), _mm256_loadu_ps(row + x - 1)), half);
+            const __m256 gy = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(rowYPlus + x), _mm256_loadu_ps(rowYMinus + x)), half);
+            const __m256 gz = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(rowZPlus + x), _mm256_loadu_ps(rowZMinus + x)), half);
+            const __m256 lengthSquared = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(gx, gx), _mm256_mul_ps(gy, gy)), _mm256_mul_ps(gz, gz));
+            _mm256_storeu_ps(result + x, _mm256_sqrt_ps(lengthSquared));
+        }
+        return x;
+    }
+
+    // The same as gradientMagnitudeRowAvx for the Laplacian
+    TNM_TARGET_AVX int laplacianRowAvx(const float* row, const float* rowYMinus, const float* rowYPlus,
+                                       const float* rowZMinus, const float* rowZPlus, int x, int dimX,
+                                       float* result)
+    {
+        const __m256 six = _mm256_set1_ps(6.f);
+        for (; x + 8 <= dimX - 1; x += 8) {
+            const __m256 nx = _mm256_add_ps(_mm256_loadu_ps(row + x - 1), _mm256_loadu_ps(row + x + 1));
+            const __m256 ny = _mm256_add_ps(_mm256_loadu_ps(rowYMinus + x), _mm256_loadu_ps(rowYPlus + x));
+            const __m256 nz = _mm256_add_ps(_mm256_loadu_ps(rowZMinus + x), _mm256_loadu_ps(rowZPlus + x));
+            const __m256 neighbors = _mm256_add_ps(_mm256_add_ps(nx, ny), nz);
+            _mm256_storeu_ps(result + x, _mm256_sub_ps(neighbors, _mm256_mul_ps(six, _mm256_loadu_ps(row + x))));
+        }
+        return x;
+    }
+#endif
+}
+
+void convertToFloat(const uint8_t* source, size_t count, float* destination) {
+    size_t i = 0;
+#ifdef TNM_USE_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= count; i += 16) {
+        const __m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+        const __m128i low = _mm_unpacklo_epi8(values, zero);
+        const __m128i high = _mm_unpackhi_epi8(values, zero);
+        _mm_storeu_ps(destination + i, _mm_cvtepi32_ps(_mm_unpacklo_epi16(low, zero)));
+        _mm_storeu_ps(destination + i + 4, _mm_cvtepi32_ps(_mm_unpackhi_epi16(low, zero)));
+        _mm_storeu_ps(destination + i + 8, _mm_cvtepi32_ps(_mm_unpacklo_epi16(high, zero)));
+        _mm_storeu_ps(destination + i + 12, _mm_cvtepi32_ps(_mm_unpackhi_epi16(high, zero)));
+    }
+#endif
+    for (; i < count; ++i)
+        destination[i] = static_cast<float>(source[i]);
+}
+
+void convertToFloat(const uint16_t* source, size_t count, float* destination) {
+    size_t i = 0;
+#ifdef TNM_USE_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 8 <= count; i += 8) {
+        const __m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+        _mm_storeu_ps(destination + i, _mm_cvtepi32_ps(_mm_unpacklo_epi16(values, zero)));
+        _mm_storeu_ps(destination + i + 4, _mm_cvtepi32_ps(_mm_unpackhi_epi16(values, zero)));
+    }
+#endif
+    for (; i < count; ++i)
+        destination[i] = static_cast<float>(source[i]);
+}
+
+void convertToFloat(const int16_t* source, size_t count, float* destination) {
+    size_t i = 0;
+#ifdef TNM_USE_SSE2
+    for (; i + 8 <= count; i += 8) {
+        const __m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+        // Placing the values in the upper half and shifting them down extends the sign
+        const __m128i low = _mm_srai_epi32(_mm_unpacklo_epi16(values, values), 16);
+        const __m128i high = _mm_srai_epi32(_mm_unpackhi_epi16(values, values), 16);
+        _mm_storeu_ps(destination + i, _mm_cvtepi32_ps(low));
+        _mm_storeu_ps(destination + i + 4, _mm_cvtepi32_ps(high));
+    }
+#endif
+    for (; i < count; ++i)
+        destination[i] = static_cast<float>(source[i]);
+}
+
+void convertToFloat(const float* source, size_t count, float* destination) {
+    std::memcpy(destination, source, count * sizeof(float));
+}
+
+void gradientMagnitudeRow(const float* row, const float* rowYMinus, const float* rowYPlus,
+                          const float* rowZMinus, const float* rowZPlus, int dimX, float* result)
+{
+    if (dimX <= 0)
+        return;
+
+    // The first and the last voxel need clamping in x and are computed separately
+    result[0] = gradientMagnitude(row, rowYMinus, rowYPlus, rowZMinus, rowZPlus, 0, 0, std::min(1, dimX - 1));
+    if (dimX == 1)
+        return;
+
+    int x = 1;
+#ifdef TNM_USE_AVX
+    if (hasAvx())
+        x = gradientMagnitudeRowAvx(row, rowYMinus, rowYPlus, rowZMinus, rowZPlus, x, dimX, result);
+#endif
+#ifdef TNM_USE_SSE2
+    const __m128 half = _mm_set1_ps(0.5f);
+    for (; x + 4 <= dimX - 1; x += 4) {
+        const __m128 gx = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(row + x + 1), _mm_loadu_ps(row + x - 1)), half);
+        const __m128 gy = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(rowYPlus + x), _mm_loadu_ps(rowYMinus + x)), half);
+        const __m128 gz = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(rowZPlus + x), _mm_loadu_ps(rowZMinus + x)), half);
+        const __m128 lengthSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(gx, gx), _mm_mul_ps(gy, gy)), _mm_mul_ps(gz, gz));
+        _mm_storeu_ps(result + x, _mm_sqrt_ps(lengthSquared));
+    }
+#endif
+    for (; x < dimX - 1; ++x)
+        result[x] = gradientMagnitude(row, rowYMinus, rowYPlus, rowZMinus, rowZPlus, x, x - 1, x + 1);
+
+    result[dimX - 1] = gradientMagnitude(row, rowYMinus, rowYPlus, rowZMinus, rowZPlus, dimX - 1, dimX - 2, dimX - 1);
+}
+
+void laplacianRow(const float* row, const float* rowYMinus, const float* rowYPlus,
+                  const float* rowZMinus, const float* rowZPlus, int dimX, float* result)
+{
+    if (dimX <= 0)
+        return;
+
+    result[0] = laplacian(row, rowYMinus, rowYPlus, rowZMinus, rowZPlus, 0, 0, std::min(1, dimX - 1));
+    if (dimX == 1)
+        return;
+
+    int x = 1;
+#ifdef TNM_USE_AVX
+    if (hasAvx())
+        x = laplacianRowAvx(row, rowYMinus, rowYPlus, rowZMinus, rowZPlus, x, dimX, result);
+#endif
+#ifdef TNM_USE_SSE2
+    const __m128 six = _mm_set1_ps(6.f);
+    for (; x + 4 <= dimX - 1; x += 4) {
+        const __m128 nx = _mm_add_ps(_mm_loadu_ps(row + x - 1), _mm_loadu_ps(row + x + 1));
+        const __m128 ny = _mm_add_ps(_mm_loadu_ps(rowYMinus + x), _mm_loadu_ps(rowYPlus + x));
+        const __m128 nz = _mm_add_ps(_mm_loadu_ps(rowZMinus + x), _mm_loadu_ps(rowZPlus + x));
+        const __m128 neighbors = _mm_add_ps(_mm_add_ps(nx, ny), nz);
+        _mm_storeu_ps(result + x, _mm_sub_ps(neighbors, _mm_mul_ps(six, _mm_loadu_ps(row + x))));
+    }
+#endif
+    for (; x < dimX - 1; ++x)
+        result[x] = laplacian(row, rowYMinus, rowYPlus, rowZMinus, rowZPlus, x, x - 1, x + 1);
+
+    result[dimX - 1] = laplacian(row, rowYMinus, rowYPlus, rowZMinus, rowZPlus, dimX - 1, dimX - 2, dimX - 1);
+}
+
+} // namespace voreen
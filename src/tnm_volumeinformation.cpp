@@ -1,15 +1,193 @@
 #include "modules/tnm093/include/tnm_volumeinformation.h"
+#include "modules/tnm093/include/tnm_chunkedfeaturefile.h"
+#include "modules/tnm093/include/tnm_integralvolume.h"
+#include "modules/tnm093/include/tnm_stencil.h"
 #include "voreen/core/datastructures/volume/volumeatomic.h"
+#include "voreen/core/datastructures/volume/volumedisk.h"
+#include "voreen/core/voreenapplication.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#ifdef _MSC_VER
+// Only for the performance counter; without NOMINMAX, windows.h defines min and max as macros,
+// which break std::min and std::max
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <time.h>
+#endif
 
 namespace voreen {
 
 	const std::string loggerCat_ = "TNMVolumeInformation";
-	
+
 namespace {
-	// This ordering function allows us to sort the Data vector by the voxelIndex
-	// The extraction *should* produce a sorted list, but you never know
-	bool sortByIndex(const VoxelDataItem& lhs, const VoxelDataItem& rhs) {
-		return lhs.voxelIndex < rhs.voxelIndex;
+	// The number of slabs per thread. Having more slabs than threads keeps all threads busy
+	// even if some slabs (e.g. the empty space around the walnut) finish earlier than others
+	const int SLABS_PER_THREAD = 4;
+
+	// The approximate number of voxels in the preview of the progressive delivery
+	const size_t PREVIEW_VOXELS = 1 << 18;
+
+	// Returns the time of a monotonic wall clock in seconds, used to report the extraction
+	// time. std::clock() is not used, as it adds up the processor time of all threads
+	double wallTime() {
+#if defined(_OPENMP)
+	    return omp_get_wtime();
+#elif defined(_MSC_VER)
+	    LARGE_INTEGER counter, frequency;
+	    QueryPerformanceCounter(&counter);
+	    QueryPerformanceFrequency(&frequency);
+	    return static_cast<double>(counter.QuadPart) / frequency.QuadPart;
+#else
+	    timespec time;
+	    clock_gettime(CLOCK_MONOTONIC, &time);
+	    return time.tv_sec + time.tv_nsec * 1e-9;
+#endif
+	}
+
+	// The name of each supported voxel type, which is part of the feature cache key
+	template<typename T> const char* voxelTypeName();
+	template<> const char* voxelTypeName<uint8_t>() { return "uint8"; }
+	template<> const char* voxelTypeName<uint16_t>() { return "uint16"; }
+	template<> const char* voxelTypeName<int16_t>() { return "int16"; }
+	template<> const char* voxelTypeName<float>() { return "float"; }
+
+	// Returns the number of threads that should be used for the requested number; 0 means all cores
+	int resolveNumThreads(int requested) {
+#ifdef _OPENMP
+	    return (requested > 0) ? requested : omp_get_num_procs();
+#else
+	    return 1;
+#endif
+	}
+
+	// Computes the (unnormalized) features for all voxels with iZ in [zBegin, zEnd) and
+	// updates minValues/maxValues with the extrema that were found in this slab.
+	// voxels and dimensions describe the part of the volume that is in memory, which has to
+	// contain the neighborhood of the slab. For every requested feature k, columns[k] receives
+	// the values for the slab, starting with the voxel (0, 0, zBegin). The voxel indices are
+	// not written; the items of a slab are the consecutive voxels starting at that voxel
+	template<typename T>
+	void extractSlab(const T* voxels, const tgt::ivec3& dimensions, int radius, FeatureMask features,
+	                 int zBegin, int zEnd, float* const* columns, float* minValues, float* maxValues)
+	{
+	    const int dim_x = dimensions.x;
+	    const int dim_y = dimensions.y;
+	    const int dim_z = dimensions.z;
+	    const size_t planeSize = static_cast<size_t>(dim_x) * dim_y;
+
+	    // Only the work for the requested features is done: the summed-volume table is only
+	    // needed for the average and standard deviation, the neighboring planes only for the
+	    // derivatives
+	    const bool needStatistics = (features & FEATURES_RADIUS_DEPENDENT) != 0;
+	    const bool needNeighbors = (features & (featureBit(FEATURE_GRADIENT_MAGNITUDE) | featureBit(FEATURE_LAPLACIAN))) != 0;
+
+	    // The average and standard deviation are looked up in the summed-volume table, which
+	    // has to be moved along z, so z is the outermost loop here
+	    IntegralVolume<T>* integralVolume = needStatistics ? new IntegralVolume<T>(voxels, dimensions, radius) : 0;
+
+	    // The planes iZ-1, iZ, and iZ+1 converted to float. Plane z is stored in buffer z % 3,
+	    // so advancing to the next plane only converts one new plane
+	    std::vector<float> planes[3];
+	    int planeZ[3] = { -1, -1, -1 };
+	    for (int k = 0; k < 3; ++k)
+	        planes[k].resize(planeSize);
+
+	    // rowStatistics always computes the average and the standard deviation; if only one
+	    // of them was requested, the other one is written into this row
+	    std::vector<float> scratchRow(dim_x);
+
+	    for (int iZ = zBegin; iZ < zEnd; ++iZ) {
+		if (integralVolume)
+		    integralVolume->setPlane(iZ);
+
+		// The derivatives use one-sided differences at the border of the volume
+		const int prevZ = needNeighbors ? std::max(iZ - 1, 0) : iZ;
+		const int topZ = needNeighbors ? std::min(iZ + 1, dim_z - 1) : iZ;
+		const int neededPlanes[3] = { prevZ, iZ, topZ };
+		for (int k = 0; k < 3; ++k) {
+		    const int z = neededPlanes[k];
+		    if (planeZ[z % 3] != z) {
+			convertToFloat(voxels + z * planeSize, planeSize, &planes[z % 3][0]);
+			planeZ[z % 3] = z;
+		    }
+		}
+		const float* planePrevZ = &planes[prevZ % 3][0];
+		const float* plane = &planes[iZ % 3][0];
+		const float* planeTopZ = &planes[topZ % 3][0];
+
+		for (int iY = 0; iY < dim_y; ++iY) {
+		    const int prevY = std::max(iY - 1, 0);
+		    const int topY = std::min(iY + 1, dim_y - 1);
+		    const float* row = plane + iY * dim_x;
+
+		    // The position of the row in the columns of the slab
+		    const size_t rowStart = (iZ - zBegin) * planeSize + iY * dim_x;
+
+		    // The values of every requested feature are written directly into its column
+		    float* rowValues[NUM_FEATURES];
+		    for (int k = 0; k < NUM_FEATURES; ++k)
+			rowValues[k] = (features & featureBit(k)) ? columns[k] + rowStart : &scratchRow[0];
+
+		    if (features & featureBit(FEATURE_INTENSITY))
+			std::copy(row, row + dim_x, rowValues[FEATURE_INTENSITY]);
+		    if (integralVolume)
+			integralVolume->rowStatistics(iY, rowValues[FEATURE_AVERAGE], rowValues[FEATURE_STD_DEVIATION]);
+		    if (features & featureBit(FEATURE_GRADIENT_MAGNITUDE)) {
+			gradientMagnitudeRow(row, plane + prevY * dim_x, plane + topY * dim_x,
+			    planePrevZ + iY * dim_x, planeTopZ + iY * dim_x, dim_x, rowValues[FEATURE_GRADIENT_MAGNITUDE]);
+		    }
+		    if (features & featureBit(FEATURE_LAPLACIAN)) {
+			laplacianRow(row, plane + prevY * dim_x, plane + topY * dim_x,
+			    planePrevZ + iY * dim_x, planeTopZ + iY * dim_x, dim_x, rowValues[FEATURE_LAPLACIAN]);
+		    }
+
+		    // Keep track of the extrema of this slab for the normalization
+		    for (int k = 0; k < NUM_FEATURES; ++k) {
+			if (!(features & featureBit(k)))
+			    continue;
+			for (int iX = 0; iX < dim_x; ++iX) {
+			    maxValues[k] = std::max(maxValues[k], rowValues[k][iX]);
+			    minValues[k] = std::min(minValues[k], rowValues[k][iX]);
+			}
+		    }
+		}
+	    }
+
+	    delete integralVolume;
+	}
+
+	// Maps the values of one feature to [-1,1] using the extrema of the complete volume
+	void normalize(float* values, size_t count, float min_value, float max_value) {
+	    for (size_t i = 0; i < count; i++) {
+		values[i] = (values[i] - min_value)/(max_value - min_value);
+
+		values[i] = (values[i] - 0.5) * 2;
+	    }
+	}
+
+	// Merges the extrema of all slabs into min_values and max_values
+	void mergeExtrema(const std::vector<float>& slabMinValues, const std::vector<float>& slabMaxValues,
+	                  float* min_values, float* max_values)
+	{
+	    for (int k = 0; k < NUM_DATA_VALUES; k++) {
+		min_values[k] = 0.0f;
+		max_values[k] = 0.0f;
+	    }
+	    for (size_t i = 0; i < slabMinValues.size(); i += NUM_DATA_VALUES) {
+		for (int k = 0; k < NUM_DATA_VALUES; k++) {
+		    max_values[k] = std::max(max_values[k], slabMaxValues[i + k]);
+		    min_values[k] = std::min(min_values[k], slabMinValues[i + k]);
+		}
+	    }
 	}
 
 }
@@ -18,10 +196,43 @@ TNMVolumeInformation::TNMVolumeInformation()
     : Processor()
     , _inport(Port::INPORT, "in.volume")
     , _outport(Port::OUTPORT, "out.data")
+    , _numThreads("numThreads", "Number of Threads (0 = all cores)", 0, 0, 64)
+    , _neighborhoodRadius("neighborhoodRadius", "Neighborhood Radius", 1, 1, 16)
+    , _useCache("useCache", "Use Feature Cache", true)
+    , _cacheDirectory("cacheDirectory", "Feature Cache Directory", "Select Cache Directory",
+        VoreenApplication::app() ? VoreenApplication::app()->getTemporaryPath() : "", "",
+        FileDialogProperty::DIRECTORY)
+    , _cacheSizeLimit("cacheSizeLimit", "Feature Cache Size Limit (MB)", 4096, 64, 1 << 20)
+    , _streaming("streaming", "Streaming Extraction", false)
+    , _memoryBudget("memoryBudget", "Streaming Memory Budget (MB)", 1024, 64, 1 << 20)
+    , _streamingFile("streamingFile", "Streamed Measures File", "Select Output File",
+        VoreenApplication::app() ? VoreenApplication::app()->getTemporaryPath("tnm093_features.tnmchunks") : "",
+        "TNM093 chunked measures (*.tnmchunks)", FileDialogProperty::SAVE_FILE)
+    , _encoding("encoding", "Feature Storage")
+    , _progressive("progressive", "Progressive Delivery", false)
+    , _refinementTimer(this)
     , _data(0)
+    , _computedFeatures(0)
+    , _computedRadius(0)
 {
     addPort(_inport);
     addPort(_outport);
+    addProperty(_numThreads);
+    addProperty(_neighborhoodRadius);
+    addProperty(_useCache);
+    addProperty(_cacheDirectory);
+    addProperty(_cacheSizeLimit);
+    addProperty(_streaming);
+    addProperty(_memoryBudget);
+    addProperty(_streamingFile);
+    addProperty(_encoding);
+    addProperty(_progressive);
+
+    // The compact encodings trade precision of the normalized values for memory
+    _encoding.addOption("float32", "32-bit Float", Data::ENCODING_FLOAT32);
+    _encoding.addOption("float16", "16-bit Half Float", Data::ENCODING_FLOAT16);
+    _encoding.addOption("fixed16", "16-bit Fixed Point", Data::ENCODING_FIXED16);
+    _encoding.addOption("fixed8", "8-bit Fixed Point", Data::ENCODING_FIXED8);
 }
 
 TNMVolumeInformation::~TNMVolumeInformation() {
@@ -30,156 +241,412 @@ TNMVolumeInformation::~TNMVolumeInformation() {
 
 void TNMVolumeInformation::process() {
     const VolumeHandleBase* volumeHandle = _inport.getData();
-    const Volume* baseVolume = volumeHandle->getRepresentation<Volume>();
-    const VolumeUInt16* volume = dynamic_cast<const VolumeUInt16*>(baseVolume);
-    if (volume == 0) {
-        return;
-    }
-    
-    // If we get this far, there actually is a volume to work with
 
     // If this is the first call, we will create the Data object
     if (_data == 0) {
 	_data = new Data;
     }
-    
+
+    if (_streaming.get()) {
+        processStreaming(volumeHandle);
+        return;
+    }
+
+    // The extraction is compiled for every supported voxel type, so each volume is processed
+    // in its native format without converting it first
+    const Volume* baseVolume = volumeHandle->getRepresentation<Volume>();
+    if (const VolumeUInt8* volume = dynamic_cast<const VolumeUInt8*>(baseVolume))
+        extractMeasures(volume);
+    else if (const VolumeUInt16* volume = dynamic_cast<const VolumeUInt16*>(baseVolume))
+        extractMeasures(volume);
+    else if (const VolumeInt16* volume = dynamic_cast<const VolumeInt16*>(baseVolume))
+        extractMeasures(volume);
+    else if (const VolumeFloat* volume = dynamic_cast<const VolumeFloat*>(baseVolume))
+        extractMeasures(volume);
+    else
+        LWARNING("Unsupported volume format; only uint8, uint16, int16 and float volumes are supported");
+}
+
+template<typename T>
+void TNMVolumeInformation::extractMeasures(const VolumeAtomic<T>* volume) {
+    // If we get this far, there actually is a volume to work with
+
     // Retrieve the size of the three dimensions of the volume
-    const tgt::svec3 dimensions = volume->getDimensions();
-    // Create as many data entries as there are voxels in the volume
-    _data->resize(dimensions.x * dimensions.y * dimensions.z);
-    
-    int dim_x = dimensions.x;
-    int dim_y = dimensions.y;
-    int dim_z = dimensions.z;
-
-    // iX is the index running over the 'x' dimension
-    // iY is the index running over the 'y' dimension
-    // iZ is the index running over the 'z' dimension
-    for (int iX = 0; iX < dim_x; ++iX) {
-	for (int iY = 0; iY < dim_y; ++iY) {
-	    for (int iZ = 0; iZ < dim_z; ++iZ) {
-		// i is a unique identifier for the voxel calculated by the following
-		// (probably one of the most important) formulas:
-		// iZ*dimensions.x*dimensions.y + iY*dimensions.x + iX;
-		const size_t i = VolumeUInt16::calcPos(volume->getDimensions(), tgt::svec3(iX, iY, iZ));
-
-		// Setting the unique identifier as the voxelIndex
-		_data->at(i).voxelIndex = i;
-		// use iX, iY, iZ, i, and the VolumeUInt16::voxel method to derive the measures here
-
-		//
-		// Intensity
-		//
-		// Retrieve the intensity using the 'VolumeUInt16's voxel method
-		float intensity = volume->voxel(_data->at(i).voxelIndex);
-		
-		_data->at(i).dataValues[0] = intensity;
-
-		//
-		// Average
-		//
-		// Compute the average; the voxel method accepts both a single parameter
-		// as well as three parameters
-		float average = .0f;
-		
-		int count = 0;
-				
-		int topX = std::min(iX + 1, (dim_x-1));
-		int topY = std::min(iY + 1, (dim_y-1));
-		int topZ = std::min(iZ + 1, (dim_z-1));
-		
-		for (int jX = std::max(iX - 1, 0); jX < topX; jX++) {
-		    for (int jY = std::max(iY - 1, 0); jY < topY; jY++) {
-			for (int jZ = std::max(iZ - 1, 0); jZ < topZ; jZ++) {
-			    average += volume->voxel(jX, jY, jZ);
-			    count++;
-			}
-		    }
-		}
-		
-		average /= count;
-
-		_data->at(i).dataValues[1] = average;
-
-		//
-		// Standard deviation
-		//
-		float stdDeviation = .0f;
-		// Compute the standard deviation
-
-		
-		for (int jX = std::max(iX -1, 0); jX < topX; jX++) {
-		    for (int jY = std::max(iY -1, 0); jY < topY; jY++) {
-			for (int jZ = std::max(iZ -1, 0); jZ < topZ; jZ++) {
-			    stdDeviation += std::pow((volume->voxel(jX, jY, jZ) - average), 2);
-			}
-		    }
-		}
-		
-// 		stdDeviation -= std::pow(intensity - average, 2);
-		stdDeviation /= count;
-		
-		stdDeviation = std::sqrt(stdDeviation);
-
-		_data->at(i).dataValues[2] = stdDeviation;
-
-		//
-		// Gradient magnitude
-		//
-		// Compute the gradient direction using either forward, central, or backward
-		// calculation and then take the magnitude (=length) of the vector.
-		// Hint:  tgt::vec3 is a class that can calculate the length for you
-
-		int prevX = std::max(iX -1, 0);
-		int prevY = std::max(iY -1, 0);
-		int prevZ = std::max(iZ -1, 0);
-		
-		tgt::vec3 gradient = tgt::vec3(.0f);
-		
-		gradient.x = volume->voxel(topX, iY, iZ) - volume->voxel(prevX, iY, iZ);
-		gradient.y = volume->voxel(iX, topY, iZ) - volume->voxel(iX, prevY, iZ);
-		gradient.z = volume->voxel(iX, iY, topZ) - volume->voxel(iX, iY, prevZ);
-		
-		gradient.x /= 2;
-		gradient.y /= 2;
-		gradient.z /= 2;
-		
-		float gradientMagnitude = tgt::length(gradient);
-		
-		_data->at(i).dataValues[3] = gradientMagnitude;
-	    }
-	}
+    const tgt::ivec3 dimensions = tgt::ivec3(volume->getDimensions());
+    const size_t planeSize = static_cast<size_t>(dimensions.x) * dimensions.y;
+    const size_t numVoxels = planeSize * dimensions.z;
+
+    const int radius = _neighborhoodRadius.get();
+    const Data::Encoding encoding = static_cast<Data::Encoding>(_encoding.getValue());
+
+    // Only the features that the connected processors read are extracted. Features that were
+    // computed for the same volume before are kept, so if a consumer requests another
+    // feature later, only that one is computed. A new volume or encoding invalidates all
+    // features, a new radius only those that depend on it
+    const FeatureMask required = collectRequiredFeatures(&_outport);
+    if (_inport.hasChanged() || _data->size() != numVoxels || _data->getEncoding() != encoding)
+        _computedFeatures = 0;
+    else if (radius != _computedRadius)
+        _computedFeatures &= ~FEATURES_RADIUS_DEPENDENT;
+    _computedRadius = radius;
+
+    // If the same volume has been processed with the same parameters before, the measures
+    // are taken from the cache instead. The cache entry may only contain some of the required
+    // features, in which case the remaining ones are computed and the entry is updated. The
+    // volume is only hashed if something has to be loaded or stored
+    FeatureCache::Key cacheKey;
+    const bool useCache = _useCache.get() && (required & ~_computedFeatures) != 0;
+    if (useCache) {
+        cacheKey = FeatureCache::Key(dimensions, voxelTypeName<T>(), radius, encoding,
+            FeatureCache::hashContent(volume->voxel(), numVoxels * sizeof(T)));
+        _featureCache.setDirectory(_cacheDirectory.get());
+        _featureCache.setSizeLimit(static_cast<uint64_t>(_cacheSizeLimit.get()) << 20);
+        FeatureMask cachedFeatures = 0;
+        if (_computedFeatures == 0 && _featureCache.load(cacheKey, *_data, cachedFeatures)) {
+            LINFO("Loaded the measures from the feature cache (" << cacheKey.fileName() << ")");
+            _computedFeatures = cachedFeatures;
+        }
+    }
+
+    const FeatureMask missing = required & ~_computedFeatures;
+    if (missing == 0) {
+        _outport.setData(_data, false);
+        return;
+    }
+
+    // With the progressive delivery, a preview is published for a new volume first, and the
+    // complete extraction runs when the processor is called again in one of the next frames
+    if (_progressive.get() && _inport.hasChanged() && _computedFeatures == 0 && numVoxels > PREVIEW_VOXELS &&
+        _refinementTimer.schedule())
+    {
+        extractPreview(volume, required);
+        return;
+    }
+
+    // Create as many data entries as there are voxels in the volume. Item i is voxel i, so
+    // the voxel indices are implicit, and only the columns of the computed features exist
+    if (_computedFeatures == 0) {
+        *_data = Data(encoding, 0);
+        _data->setImplicitVoxelIndices();
+        _data->resize(numVoxels);
+        _data->setVolumeDimensions(dimensions);
+    }
+    _data->addFeatures(missing);
+
+    // The volume is split into slabs along the z axis. Each voxel only depends on the input
+    // volume, and IntegralVolume computes the sums of every plane independently of the plane
+    // the slab starts at, so the slabs can be processed in any order and the result is
+    // identical to the serial extraction, no matter how many threads are used
+    const int numThreads = resolveNumThreads(_numThreads.get());
+    const int numSlabs = std::max(1, std::min(dimensions.z, numThreads * SLABS_PER_THREAD));
+
+    const double startTime = wallTime();
+    LINFO("Extracting " << featureNames(missing) << " with " << numThreads << " thread(s) in "
+        << numSlabs << " slabs");
+
+    // Float values are extracted directly into the data, all features in one pass. For the
+    // compact encodings, a feature can only be encoded once the extrema of the complete volume
+    // are known, so it is extracted into a float buffer first. To keep the peak memory below
+    // the one of the float encoding, the features are extracted one at a time and share a
+    // single buffer: the peak is the encoded columns plus 4 bytes per voxel, e.g. 14 bytes per
+    // voxel for five features in float16 instead of 20 for float32
+    const bool encode = (encoding != Data::ENCODING_FLOAT32);
+    std::vector<float> stagingBuffer;
+    if (encode)
+        stagingBuffer.resize(numVoxels);
+
+    for (int pass = 0; pass < NUM_FEATURES; ++pass) {
+        const FeatureMask passFeatures = encode ? (missing & featureBit(pass)) : missing;
+        if (passFeatures == 0)
+            continue;
+
+        float* columns[NUM_FEATURES];
+        for (int k = 0; k < NUM_FEATURES; ++k) {
+            columns[k] = 0;
+            if (!(passFeatures & featureBit(k)))
+                continue;
+            columns[k] = encode ? &stagingBuffer[0] : reinterpret_cast<float*>(_data->getColumnData(k));
+        }
+
+        // Every slab stores its own min/max values, which are merged once all slabs are done
+        std::vector<float> slabMaxValues(numSlabs * NUM_DATA_VALUES, 0.0f);
+        std::vector<float> slabMinValues(numSlabs * NUM_DATA_VALUES, 0.0f);
+
+#ifdef _OPENMP
+        #pragma omp parallel for num_threads(numThreads) schedule(dynamic)
+#endif
+        for (int slab = 0; slab < numSlabs; ++slab) {
+            const int zBegin = (slab * dimensions.z) / numSlabs;
+            const int zEnd = ((slab + 1) * dimensions.z) / numSlabs;
+            float* slabColumns[NUM_FEATURES];
+            for (int k = 0; k < NUM_FEATURES; ++k)
+                slabColumns[k] = columns[k] ? columns[k] + zBegin * planeSize : 0;
+            extractSlab(volume->voxel(), dimensions, radius, passFeatures, zBegin, zEnd, slabColumns,
+                &slabMinValues[slab * NUM_DATA_VALUES], &slabMaxValues[slab * NUM_DATA_VALUES]);
+        }
+
+        // normalize all data datavalues
+
+        // 1. Merge the min/max of all slabs
+        float max_values[NUM_DATA_VALUES];
+        float min_values[NUM_DATA_VALUES];
+        mergeExtrema(slabMinValues, slabMaxValues, min_values, max_values);
+
+        // 2. normalize! (and encode the values if a compact encoding is used)
+#ifdef _OPENMP
+        #pragma omp parallel for num_threads(numThreads)
+#endif
+        for (int slab = 0; slab < numSlabs; ++slab) {
+            const size_t begin = ((slab * dimensions.z) / numSlabs) * planeSize;
+            const size_t end = (((slab + 1) * dimensions.z) / numSlabs) * planeSize;
+            for (int k = 0; k < NUM_FEATURES; ++k) {
+                if (!columns[k])
+                    continue;
+                normalize(columns[k] + begin, end - begin, min_values[k], max_values[k]);
+                if (encode)
+                    _data->setValues(k, begin, end - begin, columns[k] + begin);
+            }
+        }
     }
-    
-    // normalize all data datavalues 
-    
-    // 1. Find min/max
-      
-    float max_values[NUM_DATA_VALUES] = {0.0f};
-    float min_values[NUM_DATA_VALUES] = {0.0f};
-    
-    for (int i = 0; i < (int) _data->size(); i++) {
-      for (int k = 0; k < NUM_DATA_VALUES; k++) {
-	max_values[k] = std::max(max_values[k], _data->at(i).dataValues[k]);
-	min_values[k] = std::min(min_values[k], _data->at(i).dataValues[k]);
-      }
-    }
-    
-    // 2. normalize!
-    for (int i = 0; i < (int) _data->size(); i++) {
-      for (int k = 0; k < NUM_DATA_VALUES; k++) {
-	_data->at(i).dataValues[k] = (_data->at(i).dataValues[k] - min_values[k])/(max_values[k] - min_values[k]);
-	
-	_data->at(i).dataValues[k] = (_data->at(i).dataValues[k] - 0.5) * 2;
-      }
-    }
-
-
-    // sort the data by the voxel index for faster processing later
-    std::sort(_data->begin(), _data->end(), sortByIndex);
+    _computedFeatures |= missing;
+
+    // Every voxel is stored at the position of its voxel index, so the data is sorted by the
+    // voxel index
+    LINFO("Extraction of " << numVoxels << " voxels took " << (wallTime() - startTime) << " s");
+
+    if (useCache)
+        _featureCache.store(cacheKey, *_data, _computedFeatures);
 
     // And provide access to the data using the outport
     _outport.setData(_data, false);
 }
 
+template<typename T>
+void TNMVolumeInformation::extractPreview(const VolumeAtomic<T>* volume, FeatureMask features) {
+    const tgt::ivec3 dimensions = tgt::ivec3(volume->getDimensions());
+    const size_t planeSize = static_cast<size_t>(dimensions.x) * dimensions.y;
+    const int radius = _neighborhoodRadius.get();
+    const int numThreads = resolveNumThreads(_numThreads.get());
+
+    // Every planeStride-th plane is extracted completely, so the preview covers the whole
+    // volume and its values are exact for the voxels it contains
+    const int maxPlanes = static_cast<int>(std::max<size_t>(1, PREVIEW_VOXELS / planeSize));
+    const int planeStride = (dimensions.z + maxPlanes - 1) / maxPlanes;
+    const int numPlanes = (dimensions.z + planeStride - 1) / planeStride;
+    const size_t numItems = numPlanes * planeSize;
+
+    const double startTime = wallTime();
+
+    std::vector<float> buffers[NUM_FEATURES];
+    for (int k = 0; k < NUM_FEATURES; ++k) {
+        if (features & featureBit(k))
+            buffers[k].resize(numItems);
+    }
+    std::vector<float> planeMaxValues(numPlanes * NUM_DATA_VALUES, 0.0f);
+    std::vector<float> planeMinValues(numPlanes * NUM_DATA_VALUES, 0.0f);
+
+#ifdef _OPENMP
+    #pragma omp parallel for num_threads(numThreads) schedule(dynamic)
+#endif
+    for (int plane = 0; plane < numPlanes; ++plane) {
+        const int z = plane * planeStride;
+        float* planeColumns[NUM_FEATURES];
+        for (int k = 0; k < NUM_FEATURES; ++k)
+            planeColumns[k] = buffers[k].empty() ? 0 : &buffers[k][plane * planeSize];
+        extractSlab(volume->voxel(), dimensions, radius, features, z, z + 1, planeColumns,
+            &planeMinValues[plane * NUM_DATA_VALUES], &planeMaxValues[plane * NUM_DATA_VALUES]);
+    }
+
+    // The preview is normalized with its own extrema, which are close to the ones of the volume
+    float max_values[NUM_DATA_VALUES];
+    float min_values[NUM_DATA_VALUES];
+    mergeExtrema(planeMinValues, planeMaxValues, min_values, max_values);
+
+    *_data = Data(static_cast<Data::Encoding>(_encoding.getValue()), features);
+    _data->setVolumeDimensions(dimensions);
+    _data->resize(numItems);
+    VoxelIndex* voxelIndices = _data->getVoxelIndices();
+    for (int plane = 0; plane < numPlanes; ++plane) {
+        const VoxelIndex firstIndex = static_cast<VoxelIndex>(plane * planeStride) * planeSize;
+        for (size_t i = 0; i < planeSize; ++i)
+            voxelIndices[plane * planeSize + i] = firstIndex + i;
+    }
+    for (int k = 0; k < NUM_FEATURES; ++k) {
+        if (buffers[k].empty())
+            continue;
+        normalize(&buffers[k][0], numItems, min_values[k], max_values[k]);
+        _data->setValues(k, 0, numItems, &buffers[k][0]);
+    }
+
+    LINFO("Preview of every " << planeStride << ". plane took " << (wallTime() - startTime) << " s");
+
+    _outport.setData(_data, false);
+}
+
+void TNMVolumeInformation::processStreaming(const VolumeHandleBase* volumeHandle) {
+    // If the volume has not been loaded yet, the voxels are read directly from the file, so
+    // the volume never has to fit into memory
+    if (volumeHandle->hasRepresentation<VolumeDisk>()) {
+        const VolumeDisk* disk = volumeHandle->getRepresentation<VolumeDisk>();
+        const std::string format = disk->getFormat();
+        const std::string fileName = disk->getFileName();
+        const tgt::ivec3 dimensions = tgt::ivec3(disk->getDimensions());
+        const uint64_t offset = disk->getOffset();
+
+        if (format == "UCHAR" || format == "uint8")
+            streamMeasures(RawFileSlabReader<uint8_t>(fileName, dimensions, offset));
+        else if (format == "USHORT" || format == "uint16")
+            streamMeasures(RawFileSlabReader<uint16_t>(fileName, dimensions, offset));
+        else if (format == "SHORT" || format == "int16")
+            streamMeasures(RawFileSlabReader<int16_t>(fileName, dimensions, offset));
+        else if (format == "FLOAT" || format == "float")
+            streamMeasures(RawFileSlabReader<float>(fileName, dimensions, offset));
+        else
+            LWARNING("Unsupported volume format " << format);
+        return;
+    }
+
+    const Volume* baseVolume = volumeHandle->getRepresentation<Volume>();
+    if (const VolumeUInt8* volume = dynamic_cast<const VolumeUInt8*>(baseVolume))
+        streamMeasures(MemorySlabReader<uint8_t>(volume));
+    else if (const VolumeUInt16* volume = dynamic_cast<const VolumeUInt16*>(baseVolume))
+        streamMeasures(MemorySlabReader<uint16_t>(volume));
+    else if (const VolumeInt16* volume = dynamic_cast<const VolumeInt16*>(baseVolume))
+        streamMeasures(MemorySlabReader<int16_t>(volume));
+    else if (const VolumeFloat* volume = dynamic_cast<const VolumeFloat*>(baseVolume))
+        streamMeasures(MemorySlabReader<float>(volume));
+    else
+        LWARNING("Unsupported volume format; only uint8, uint16, int16 and float volumes are supported");
+}
+
+template<typename T>
+void TNMVolumeInformation::streamMeasures(const VolumeSlabReader<T>& reader) {
+    const tgt::ivec3 dimensions = reader.getDimensions();
+    const size_t planeSize = static_cast<size_t>(dimensions.x) * dimensions.y;
+    const VoxelIndex numVoxels = static_cast<VoxelIndex>(planeSize) * dimensions.z;
+    const int radius = _neighborhoodRadius.get();
+    // The number of planes that are needed on each side of a slab for the neighborhoods
+    const int halo = std::max(1, radius);
+    const int numThreads = resolveNumThreads(_numThreads.get());
+    const FeatureMask features = collectRequiredFeatures(&_outport);
+    const int numFeatures = featureCount(features);
+    // The published data is only a subsample, so nothing can be reused by a later in-memory run
+    _computedFeatures = 0;
+
+    // A quarter of the memory budget is reserved for the subsampled measures that are
+    // published on the outport; the rest is split among the threads. Each thread needs a
+    // fixed amount for the summed-volume tables, the float planes and the halo planes, and
+    // then the input voxels and the extracted features for every plane of its slab
+    const uint64_t budget = static_cast<uint64_t>(_memoryBudget.get()) << 20;
+    const uint64_t sampleBudget = budget / 4;
+    const uint64_t threadBudget = (budget - sampleBudget) / numThreads;
+    const uint64_t fixedCost = planeSize * (4 * sizeof(typename IntegralVolume<T>::Accumulator) +
+        3 * sizeof(float) + 2 * halo * sizeof(T));
+    const uint64_t costPerPlane = planeSize * (sizeof(T) + numFeatures * sizeof(float));
+    uint64_t slabDepth = 1;
+    if (threadBudget > fixedCost + costPerPlane)
+        slabDepth = (threadBudget - fixedCost) / costPerPlane;
+    else
+        LWARNING("The memory budget is too small for " << numThreads << " thread(s); using one plane per slab");
+    slabDepth = std::min(slabDepth, static_cast<uint64_t>(dimensions.z));
+    const int numSlabs = static_cast<int>((dimensions.z + slabDepth - 1) / slabDepth);
+
+    // Every sampleStride-th voxel is kept in memory and published on the outport. The sample
+    // is collected as floats and encoded at the end
+    const uint64_t sampleBytes = numVoxels * numFeatures * sizeof(float);
+    const uint64_t sampleStride = std::max<uint64_t>(1, (sampleBytes + sampleBudget - 1) / sampleBudget);
+    const size_t numSamples = static_cast<size_t>((numVoxels + sampleStride - 1) / sampleStride);
+    std::vector<float> sampleColumns[NUM_FEATURES];
+    for (int k = 0; k < NUM_FEATURES; ++k) {
+        if (features & featureBit(k))
+            sampleColumns[k].resize(numSamples);
+    }
+
+    ChunkedFeatureWriter writer;
+    if (!writer.open(_streamingFile.get(), dimensions, features)) {
+        LERROR("Could not create " << _streamingFile.get());
+        // The outport must not keep publishing the measures of a previous run
+        _data->clear();
+        _outport.setData(0, false);
+        return;
+    }
+
+    const double startTime = wallTime();
+    LINFO("Streaming extraction with " << numThreads << " thread(s) in " << numSlabs << " slabs of "
+        << slabDepth << " planes, keeping every " << sampleStride << ". voxel in memory");
+
+    std::vector<float> slabMaxValues(numSlabs * NUM_DATA_VALUES, 0.0f);
+    std::vector<float> slabMinValues(numSlabs * NUM_DATA_VALUES, 0.0f);
+    bool success = true;
+
+#ifdef _OPENMP
+    #pragma omp parallel for num_threads(numThreads) schedule(dynamic)
+#endif
+    for (int slab = 0; slab < numSlabs; ++slab) {
+        const int zBegin = static_cast<int>(slab * slabDepth);
+        const int zEnd = std::min(static_cast<int>(zBegin + slabDepth), dimensions.z);
+        const int haloBegin = std::max(zBegin - halo, 0);
+        const int haloEnd = std::min(zEnd + halo, dimensions.z);
+        const VoxelIndex firstIndex = static_cast<VoxelIndex>(zBegin) * planeSize;
+        const size_t numItems = (zEnd - zBegin) * planeSize;
+
+        std::vector<T> voxels((haloEnd - haloBegin) * planeSize);
+        std::vector<float> slabValues(numFeatures * numItems);
+        float* slabColumns[NUM_FEATURES];
+        for (int k = 0, column = 0; k < NUM_FEATURES; ++k)
+            slabColumns[k] = (features & featureBit(k)) ? &slabValues[(column++) * numItems] : 0;
+
+        bool slabRead = reader.readPlanes(haloBegin, haloEnd, &voxels[0]);
+        if (slabRead) {
+            extractSlab(&voxels[0], tgt::ivec3(dimensions.x, dimensions.y, haloEnd - haloBegin), radius, features,
+                zBegin - haloBegin, zEnd - haloBegin, slabColumns,
+                &slabMinValues[slab * NUM_DATA_VALUES], &slabMaxValues[slab * NUM_DATA_VALUES]);
+
+            // Keep the voxels whose index is a multiple of the stride
+            VoxelIndex i = ((firstIndex + sampleStride - 1) / sampleStride) * sampleStride;
+            for (; i < firstIndex + numItems; i += sampleStride) {
+                for (int k = 0; k < NUM_FEATURES; ++k) {
+                    if (slabColumns[k])
+                        sampleColumns[k][static_cast<size_t>(i / sampleStride)] = slabColumns[k][static_cast<size_t>(i - firstIndex)];
+                }
+            }
+        }
+
+#ifdef _OPENMP
+        #pragma omp critical(TNMVolumeInformation_writeChunk)
+#endif
+        {
+            if (!slabRead || !writer.writeChunk(firstIndex, slabColumns, numItems))
+                success = false;
+        }
+    }
+
+    float max_values[NUM_DATA_VALUES];
+    float min_values[NUM_DATA_VALUES];
+    mergeExtrema(slabMinValues, slabMaxValues, min_values, max_values);
+
+    if (!writer.close(min_values, max_values) || !success) {
+        LERROR("Streaming extraction failed, " << _streamingFile.get() << " is incomplete");
+        _data->clear();
+        _outport.setData(0, false);
+        return;
+    }
+
+    *_data = Data(static_cast<Data::Encoding>(_encoding.getValue()), features);
+    _data->setImplicitVoxelIndices(sampleStride);
+    _data->setVolumeDimensions(dimensions);
+    _data->resize(numSamples);
+    for (int k = 0; k < NUM_FEATURES; ++k) {
+        if (!(features & featureBit(k)))
+            continue;
+        normalize(&sampleColumns[k][0], numSamples, min_values[k], max_values[k]);
+        _data->setValues(k, 0, numSamples, &sampleColumns[k][0]);
+    }
+
+    LINFO("Streaming extraction of " << numVoxels << " voxels took " << (wallTime() - startTime)
+        << " s; the full resolution measures are in " << _streamingFile.get());
+
+    _outport.setData(_data, false);
+}
+
 } // namespace
@@ -0,0 +1,64 @@
+#include "modules/tnm093/include/tnm_volumeslabreader.h"
+
+#include <cstring>
+#include <fstream>
+
+namespace voreen {
+
+template<typename T>
+MemorySlabReader<T>::MemorySlabReader(const VolumeAtomic<T>* volume)
+    : _volume(volume)
+{}
+
+template<typename T>
+tgt::ivec3 MemorySlabReader<T>::getDimensions() const {
+    return tgt::ivec3(_volume->getDimensions());
+}
+
+template<typename T>
+bool MemorySlabReader<T>::readPlanes(int zBegin, int zEnd, T* destination) const {
+    const tgt::svec3 dimensions = _volume->getDimensions();
+    const size_t planeSize = dimensions.x * dimensions.y;
+    std::memcpy(destination, _volume->voxel() + zBegin * planeSize,
+        (zEnd - zBegin) * planeSize * sizeof(T));
+    return true;
+}
+
+
+template<typename T>
+RawFileSlabReader<T>::RawFileSlabReader(const std::string& fileName, const tgt::ivec3& dimensions,
+                                     uint64_t offset)
+    : _fileName(fileName)
+    , _dimensions(dimensions)
+    , _offset(offset)
+{}
+
+template<typename T>
+tgt::ivec3 RawFileSlabReader<T>::getDimensions() const {
+    return _dimensions;
+}
+
+template<typename T>
+bool RawFileSlabReader<T>::readPlanes(int zBegin, int zEnd, T* destination) const {
+    // Every call opens its own stream, so that multiple threads can read at the same time
+    std::ifstream file(_fileName.c_str(), std::ios::binary);
+    if (!file)
+        return false;
+
+    const uint64_t planeBytes = static_cast<uint64_t>(_dimensions.x) * _dimensions.y * sizeof(T);
+    file.seekg(static_cast<std::streamoff>(_offset + zBegin * planeBytes));
+    file.read(reinterpret_cast<char*>(destination), static_cast<std::streamsize>((zEnd - zBegin) * planeBytes));
+    return !file.fail();
+}
+
+template class MemorySlabReader<uint8_t>;
+template class MemorySlabReader<uint16_t>;
+template class MemorySlabReader<int16_t>;
+template class MemorySlabReader<float>;
+
+template class RawFileSlabReader<uint8_t>;
+template class RawFileSlabReader<uint16_t>;
+template class RawFileSlabReader<int16_t>;
+template class RawFileSlabReader<float>;
+
+} // namespace voreen
@@ -4,3 +4,13 @@ DEFINES += VRN_MODULE_TNM093
 VRN_MODULE_CLASSES += TNM093Module
 VRN_MODULE_CLASS_HEADERS += tnm093/tnm093module.h
 VRN_MODULE_CLASS_SOURCES += tnm093/tnm093module.cpp
+
+# OpenMP is used to parallelize the feature extraction; without it everything runs serially
+unix {
+    QMAKE_CXXFLAGS += -fopenmp
+    QMAKE_LFLAGS += -fopenmp
+}
+
+# The brushing of the parallel coordinates runs on a thread of its own
+unix: LIBS += -lpthread
+win32: QMAKE_CXXFLAGS += /openmp
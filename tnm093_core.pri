@@ -1,16 +1,48 @@
 SOURCES += \
     $${VRN_MODULE_DIR}/tnm093/src/indexproperty.cpp \
+    $${VRN_MODULE_DIR}/tnm093/src/tnm_featurecache.cpp \
+    $${VRN_MODULE_DIR}/tnm093/src/tnm_featureregistry.cpp \
+    $${VRN_MODULE_DIR}/tnm093/src/tnm_indexset.cpp \
+    $${VRN_MODULE_DIR}/tnm093/src/tnm_integralvolume.cpp \
+    $${VRN_MODULE_DIR}/tnm093/src/tnm_alignedbuffer.cpp \
+    $${VRN_MODULE_DIR}/tnm093/src/tnm_brushingindex.cpp \
+    $${VRN_MODULE_DIR}/tnm093/src/tnm_brushingworker.cpp \
+    $${VRN_MODULE_DIR}/tnm093/src/tnm_chunkedfeaturefile.cpp \
+    $${VRN_MODULE_DIR}/tnm093/src/tnm_columnbuffers.cpp \
+    $${VRN_MODULE_DIR}/tnm093/src/tnm_data.cpp \
     $${VRN_MODULE_DIR}/tnm093/src/tnm_datareduction.cpp \
     $${VRN_MODULE_DIR}/tnm093/src/tnm_parallelcoordinates.cpp \
+    $${VRN_MODULE_DIR}/tnm093/src/tnm_pickingtarget.cpp \
     $${VRN_MODULE_DIR}/tnm093/src/tnm_raycaster.cpp \
+    $${VRN_MODULE_DIR}/tnm093/src/tnm_refinementtimer.cpp \
     $${VRN_MODULE_DIR}/tnm093/src/tnm_scatterplot.cpp \
-    $${VRN_MODULE_DIR}/tnm093/src/tnm_volumeinformation.cpp
+    $${VRN_MODULE_DIR}/tnm093/src/tnm_scatterplotmatrix.cpp \
+    $${VRN_MODULE_DIR}/tnm093/src/tnm_stencil.cpp \
+    $${VRN_MODULE_DIR}/tnm093/src/tnm_volumeinformation.cpp \
+    $${VRN_MODULE_DIR}/tnm093/src/tnm_volumeslabreader.cpp
 
 HEADERS += \
     $${VRN_MODULE_DIR}/tnm093/include/indexproperty.h \
+    $${VRN_MODULE_DIR}/tnm093/include/tnm_alignedbuffer.h \
+    $${VRN_MODULE_DIR}/tnm093/include/tnm_brushingindex.h \
+    $${VRN_MODULE_DIR}/tnm093/include/tnm_brushingworker.h \
+    $${VRN_MODULE_DIR}/tnm093/include/tnm_chunkedfeaturefile.h \
+    $${VRN_MODULE_DIR}/tnm093/include/tnm_columnbuffers.h \
     $${VRN_MODULE_DIR}/tnm093/include/tnm_datareduction.h \
     $${VRN_MODULE_DIR}/tnm093/include/tnm_common.h \
+    $${VRN_MODULE_DIR}/tnm093/include/tnm_copyonwrite.h \
+    $${VRN_MODULE_DIR}/tnm093/include/tnm_data.h \
+    $${VRN_MODULE_DIR}/tnm093/include/tnm_featurecache.h \
+    $${VRN_MODULE_DIR}/tnm093/include/tnm_featureregistry.h \
+    $${VRN_MODULE_DIR}/tnm093/include/tnm_indexset.h \
+    $${VRN_MODULE_DIR}/tnm093/include/tnm_integralvolume.h \
     $${VRN_MODULE_DIR}/tnm093/include/tnm_parallelcoordinates.h \
+    $${VRN_MODULE_DIR}/tnm093/include/tnm_pickingtarget.h \
+    $${VRN_MODULE_DIR}/tnm093/include/tnm_quantization.h \
     $${VRN_MODULE_DIR}/tnm093/include/tnm_raycaster.h \
-    $${VRN_MODULE_DIR}/tnm093/include/tnm_scatter.h \
-    $${VRN_MODULE_DIR}/tnm093/include/tnm_volumeinformation.h
+    $${VRN_MODULE_DIR}/tnm093/include/tnm_refinementtimer.h \
+    $${VRN_MODULE_DIR}/tnm093/include/tnm_scatterplot.h \
+    $${VRN_MODULE_DIR}/tnm093/include/tnm_scatterplotmatrix.h \
+    $${VRN_MODULE_DIR}/tnm093/include/tnm_stencil.h \
+    $${VRN_MODULE_DIR}/tnm093/include/tnm_volumeinformation.h \
+    $${VRN_MODULE_DIR}/tnm093/include/tnm_volumeslabreader.h
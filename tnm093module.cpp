@@ -32,6 +32,7 @@
 #include "modules/tnm093/include/tnm_parallelcoordinates.h"
 #include "modules/tnm093/include/tnm_raycaster.h"
 #include "modules/tnm093/include/tnm_scatterplot.h"
+#include "modules/tnm093/include/tnm_scatterplotmatrix.h"
 #include "modules/tnm093/include/tnm_volumeinformation.h"
 
 namespace voreen {
@@ -47,6 +48,7 @@ TNM093Module::TNM093Module()
     addProcessor(new TNMParallelCoordinates);
     addProcessor(new TNMRaycaster);
     addProcessor(new TNMScatterPlot);
+    addProcessor(new TNMScatterPlotMatrix);
     addProcessor(new TNMVolumeInformation);
 }
 